@@ -85,12 +85,152 @@ defining the data type, it serves as a unique identifier, or "tag class" in C++
 parlance, of the default value. The value itself is stored as a thread_local
 variable within OptArg, so there should be one default defined per thread per
 tag.
+
+Threads:
+	Since every default lives in thread_local storage, OptArg and WithDefArg
+	need no locking of any kind. A WithDefArg declared on one thread is never
+	visible to another, and a newly started thread always begins with the root
+	default (see CustomDef below) regardless of what its parent was doing.
+
+	This isolation comes with a few rules worth spelling out:
+
+	1. WithDefArg instances must be destroyed in the reverse order of their
+	   construction on the thread that made them. Declaring them as local
+	   variables guarantees this, including when an exception unwinds through
+	   them: each one restores the value it saved on the way out.
+	2. Never hand a WithDefArg to another thread or store it somewhere that
+	   outlives its scope. It restores the default of whichever thread runs
+	   its destructor.
+	3. GetDefault() returns a reference into the calling thread's storage. Do
+	   not pass that reference to other threads; copy the value instead.
+	4. Pooled threads keep whatever defaults they had when their last task
+	   finished, so a task that calls SetDefault without a matching restore
+	   leaks that setting into the next task on the same thread. WithDefArg
+	   does not have this problem.
 **/
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_set>
 #include <utility>
+#include <vector>
+
+/**
+Configuration macros
+
+You may define any of these before including optarg.hpp to change its
+compile-time behaviour. Each falls back to the value shown if left undefined.
+
+	OPTARG_REALTIME 0:
+		When set to 1, every tag is treated as a real-time tag (see TagTraits)
+		unless the tag itself says otherwise.
+	OPTARG_STACK_DEPTH 0:
+		The fallback for the stack_depth tag setting (see TagTraits). Setting
+		this to N gives every tag that does not say otherwise a fixed-size
+		per-thread stack of N saved defaults.
+	OPTARG_TLS_MAX 0:
+		When nonzero, any tag that does not choose its own storage setting
+		(see TagTraits) and whose value type is larger than this many bytes
+		gets kStorage::Arena rather than kStorage::TLS. This keeps large
+		defaults out of static TLS, which is a limited resource: a dlopen'ed
+		library with many big thread_locals can fail to load once it runs
+		out. See GetThreadFootprint for a way to find out what your tags
+		cost.
+	OPTARG_SECTION_REGISTRY (1 for ELF targets, 0 otherwise):
+		When set to 1, OPTARG_REGISTER records tags in a linker section
+		rather than through static initializers. See "Tag registry" below.
+		Each shared object gets a section of its own, and RegisteredTags
+		only reads the one belonging to whichever object its code ended up
+		in. So if you register tags from more than one shared object, set
+		this to 0.
+	OPTARG_LAYOUT_PROFILE 0:
+		When set to 1, every read of a default gets tallied along with the
+		other tags the thread read just before it, so that you can have
+		WriteLayoutSpec suggest which grouped tags should sit next to each
+		other. This pulls in optarg_layout.hpp; see there for details. It
+		costs an uncontended lock per read, so it is meant for profiling
+		builds only.
+	OPTARG_LAYOUT_FILE (undefined):
+		Names a layout file written by WriteLayoutSpec, as a string that
+		#include accepts (e.g. -DOPTARG_LAYOUT_FILE='"tag_layout.inc"'). The
+		per-thread block of each group (see TagTraits) then starts with the
+		tags the file lists for it, in the order listed. Tags the file does
+		not list, or whose size or alignment has since changed, go after
+		those.
+	OPTARG_RECORD 0:
+		When set to 1, every change made to a default through SetDefault,
+		SetRootDefault or WithDefArg can be recorded to a file for later
+		replay. This pulls in optarg_record.hpp; see there for details. When
+		left at 0, the recording hooks compile to nothing at all.
+	OPTARG_USDT 0:
+		When set to 1, SetDefault, SetRootDefault and WithDefArg construction
+		and destruction fire USDT static probes, which tools like bpftrace
+		and perf can attach to in a running process. This requires
+		<sys/sdt.h> (from systemtap's SDT development package). Probes that
+		nothing is attached to cost a single NOP each. The probes all belong
+		to the "optarg" provider:
+
+			set_default(name, bits, size)
+			set_root_default(name, bits, size)
+			scope_enter(name, bits, size)
+			scope_exit(name, bits, size)
+
+		name is the tag's name (see RegisterTag) or else its typeid name.
+		bits holds the first 8 bytes of the resulting default if its type is
+		trivially copyable, and size is the size of that type. For example:
+
+			$ bpftrace -e 'usdt:./server:optarg:scope_enter
+				{ printf("%d %s %d\n", tid, str(arg0), arg1); }'
+**/
+#ifndef OPTARG_REALTIME
+	#define OPTARG_REALTIME 0
+#endif
+#ifndef OPTARG_STACK_DEPTH
+	#define OPTARG_STACK_DEPTH 0
+#endif
+#ifndef OPTARG_TLS_MAX
+	#define OPTARG_TLS_MAX 0
+#endif
+#ifndef OPTARG_SECTION_REGISTRY
+	#if defined(__ELF__) && defined(__GNUC__)
+		#define OPTARG_SECTION_REGISTRY 1
+	#else
+		#define OPTARG_SECTION_REGISTRY 0
+	#endif
+#endif
+#ifndef OPTARG_LAYOUT_PROFILE
+	#define OPTARG_LAYOUT_PROFILE 0
+#endif
+#ifndef OPTARG_RECORD
+	#define OPTARG_RECORD 0
+#endif
+#ifndef OPTARG_USDT
+	#define OPTARG_USDT 0
+#endif
+#if OPTARG_USDT
+	#if __has_include(<sys/sdt.h>)
+		#include <sys/sdt.h>
+	#else
+		#error "OPTARG_USDT needs <sys/sdt.h>"
+	#endif
+#endif
 
 namespace oarg {
 
@@ -182,6 +322,414 @@ namespace oarg {
 			constexpr CustomDefByFn() noexcept: CustomDefTmpl<T>{DefFn()} {}
 		};
 
+	/**
+	TagTraits
+
+	Aside from its "type" definition, a tag struct may declare a few optional
+	settings that change how its default is managed. TagTraits collects these
+	in one place, substituting a fallback for any setting the tag leaves out.
+	You should never need to specialize it yourself.
+
+		realtime:
+			static constexpr bool realtime = true;
+
+			Marks the tag as safe to use from a real-time thread (e.g. audio
+			or trading code) that must never allocate or take a lock. The
+			header enforces this with static_asserts in OptArg and WithDefArg:
+
+			- The value type must be trivially copyable. Saving and restoring
+			  it is then a plain memory copy that cannot allocate or throw.
+			- It must be nothrow default-constructible, since that is how the
+			  thread_local default gets initialized.
+			- Any merge functor passed to WithDefArg must be noexcept.
+
+			Whether the tag defaults to real-time is governed by the
+			OPTARG_REALTIME macro.
+
+			Note that a thread_local default is only initialized lazily (and
+			possibly with a lock held in the runtime) if its constructor is not
+			constexpr or if it lives in a dlopen'ed library. Call WarmDefaults
+			at the top of your real-time thread function to get this out of the
+			way before entering the real-time section.
+
+		stack_depth:
+			static constexpr std::size_t stack_depth = 8;
+
+			Normally, every WithDefArg embeds a copy of the default it replaced
+			so that it can put it back later. Give a tag a nonzero stack_depth
+			and the saved values go into a fixed-size per-thread stack instead,
+			leaving the WithDefArg itself empty. The memory a tag can use on a
+			thread is then known at compile time: stack_depth + 1 values. The
+			fallback comes from the OPTARG_STACK_DEPTH macro.
+
+		overflow:
+			static constexpr auto overflow = oarg::kOverflow::Skip;
+
+			This decides what happens when WithDefArgs for a tag with a
+			stack_depth nest any deeper than that.
+
+			kOverflow::Terminate:
+				The fallback. Calls std::terminate.
+			kOverflow::Skip:
+				The overflowing WithDefArg (and any nested inside it) leaves the
+				default unchanged. The stack keeps count regardless, so it will
+				unwind correctly once those scopes exit.
+
+		storage:
+			static constexpr auto storage = oarg::kStorage::Arena;
+
+			This chooses where each thread keeps its copy of the default.
+
+			kStorage::TLS:
+				The fallback (unless the OPTARG_TLS_MAX macro says otherwise).
+				The default is a thread_local variable of its own.
+				If its type is not trivially destructible, every thread that
+				touches it has the runtime register a separate destructor to
+				call when the thread exits.
+			kStorage::Arena:
+				The default gets constructed in a per-thread arena the first
+				time the thread touches it. The arena registers one exit handler
+				no matter how many tags live in it, and that handler runs all of
+				their destructors in a single pass before releasing the arena's
+				memory. Consider this for programs that have many string or
+				vector defaults and also start lots of short-lived threads. The
+				price is a null pointer check on each access. (Also note that if
+				the value's default constructor throws or the arena cannot
+				allocate memory, std::terminate gets called.)
+
+		group:
+			using group = storage_grp;
+
+			Names a tag group, which is simply an empty struct you declare
+			for the purpose. All the tags of a group can be reset at once
+			with ResetGroup (see below). In addition, grouping affects
+			arena-stored tags as follows.
+
+			Rather than each tag getting its own spot in the arena, all tags
+			in a group share one per-thread block, laid out once at program
+			start-up. The block is allocated and every default in it gets
+			constructed the first time a thread touches any member of the
+			group. So a thread pays for the groups it uses rather than for
+			every tag in the program, and it keeps little per-tag
+			thread_local state: only a small header per group and a
+			generation count per tag for ResetGroup's sake. This is worth
+			considering once you are into the hundreds or thousands of tags.
+
+			(A tag registered after a thread has already built its block,
+			e.g. from a dlopen'ed library, gets placed in an extra block on
+			that thread. This is handled automatically.)
+
+			Tags sit in the block in the order they registered, which
+			depends on the order of static initialization. To put the tags
+			that get read together next to each other instead, see the
+			OPTARG_LAYOUT_FILE macro.
+
+		notify:
+			static constexpr bool notify = true;
+
+			Lets other code subscribe to changes made to the default through
+			SetDefault. See Subscribe below.
+
+		process_root:
+			static constexpr bool process_root = true;
+
+			Gives the tag a process-wide root default that sits behind the
+			per-thread ones. You read and publish it with OptArg's
+			GetRootDefault and SetRootDefault. A thread that has not
+			overridden the default (through SetDefault or an active
+			WithDefArg) sees whatever root was last published, so a change
+			to the root reaches every such thread immediately.
+
+			Between the thread and the process sits an optional middle
+			layer: the thread's ThreadGroup (see below). If the thread has
+			joined a group for which SetGroupDefault has published an
+			override, it sees that override instead of the root.
+
+			Publishing is lock-free from a reader's point of view: roots and
+			group overrides live in immutable heap objects that get swapped
+			in with atomic pointer exchanges. Each thread caches a pointer to
+			the default it resolved to, and revalidates it against a
+			process-wide version counter that every publication bumps. So a
+			read costs a load of that counter, a compare, and a load of the
+			cached pointer. Since a reader could still be looking at a
+			previous value, everything you publish stays allocated until the
+			program exits. Root and group defaults are meant to change rarely
+			(e.g. by an operator via optarg_admin.hpp).
+
+		alloc_stats:
+			static constexpr bool alloc_stats = true;
+
+			Counts the heap allocations made on any thread while a WithDefArg
+			of this tag is the innermost such scope on that thread. This needs
+			optarg_allocstats.hpp; see there for how to get at the counts.
+			Each WithDefArg of the tag costs a couple of thread_local pointer
+			swaps. Tags without the setting cost nothing.
+
+		prewarm:
+			static constexpr bool prewarm = true;
+
+			Has WarmThread (see below) initialize the calling thread's
+			default for this tag. Tags with non-trivial value types or arena
+			storage are worth marking this way if you want worker threads to
+			get their first-touch costs over with at start-up.
+	**/
+	enum class kOverflow { Terminate, Skip };
+	enum class kStorage { TLS, Arena };
+	namespace detail {
+		template<typename Tag, typename Enable = void>
+			struct TagRealTime: std::bool_constant<OPTARG_REALTIME != 0> {};
+		template<typename Tag>
+			struct TagRealTime<Tag, std::void_t<decltype(Tag::realtime)>>:
+				std::bool_constant<Tag::realtime> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagStackDepth:
+				std::integral_constant<std::size_t, OPTARG_STACK_DEPTH> {};
+		template<typename Tag>
+			struct TagStackDepth<
+				Tag, std::void_t<decltype(Tag::stack_depth)>
+				>:
+				std::integral_constant<std::size_t, Tag::stack_depth> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagOverflow:
+				std::integral_constant<kOverflow, kOverflow::Terminate> {};
+		template<typename Tag>
+			struct TagOverflow<Tag, std::void_t<decltype(Tag::overflow)>>:
+				std::integral_constant<kOverflow, Tag::overflow> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagTypeSize: std::integral_constant<std::size_t, 0> {};
+		template<typename Tag>
+			struct TagTypeSize<Tag, std::void_t<typename Tag::type>>:
+				std::integral_constant<std::size_t, sizeof(typename Tag::type)>
+				{};
+
+		template<typename Tag, typename Enable = void>
+			struct TagStorage:
+				std::integral_constant<
+					kStorage,
+					(OPTARG_TLS_MAX > 0 &&
+						TagTypeSize<Tag>::value > OPTARG_TLS_MAX) ?
+						kStorage::Arena : kStorage::TLS
+					> {};
+		template<typename Tag>
+			struct TagStorage<Tag, std::void_t<decltype(Tag::storage)>>:
+				std::integral_constant<kStorage, Tag::storage> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagNotify: std::false_type {};
+		template<typename Tag>
+			struct TagNotify<Tag, std::void_t<decltype(Tag::notify)>>:
+				std::bool_constant<Tag::notify> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagProcessRoot: std::false_type {};
+		template<typename Tag>
+			struct TagProcessRoot<
+				Tag, std::void_t<decltype(Tag::process_root)>
+				>:
+				std::bool_constant<Tag::process_root> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagAllocStats: std::false_type {};
+		template<typename Tag>
+			struct TagAllocStats<
+				Tag, std::void_t<decltype(Tag::alloc_stats)>
+				>:
+				std::bool_constant<Tag::alloc_stats> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagPrewarm: std::false_type {};
+		template<typename Tag>
+			struct TagPrewarm<Tag, std::void_t<decltype(Tag::prewarm)>>:
+				std::bool_constant<Tag::prewarm> {};
+
+		template<typename Tag, typename Enable = void>
+			struct TagGroup { using type = void; };
+		template<typename Tag>
+			struct TagGroup<Tag, std::void_t<typename Tag::group>> {
+				using type = typename Tag::group;
+			};
+
+		template<typename Value>
+			constexpr bool kRealTimeSafe =
+				std::is_trivially_copyable_v<Value> &&
+				std::is_nothrow_default_constructible_v<Value>;
+	}
+	template<typename Tag>
+		struct TagTraits {
+			static constexpr bool kRealTime = detail::TagRealTime<Tag>::value;
+			static constexpr std::size_t kStackDepth =
+				detail::TagStackDepth<Tag>::value;
+			static constexpr kOverflow kOnOverflow =
+				detail::TagOverflow<Tag>::value;
+			static constexpr kStorage kStoreIn = detail::TagStorage<Tag>::value;
+			using TGroup = typename detail::TagGroup<Tag>::type;
+			static constexpr bool kNotify = detail::TagNotify<Tag>::value;
+			static constexpr bool kProcessRoot =
+				detail::TagProcessRoot<Tag>::value;
+			static constexpr bool kAllocStats =
+				detail::TagAllocStats<Tag>::value;
+			static constexpr bool kPrewarm = detail::TagPrewarm<Tag>::value;
+		};
+
+	namespace detail {
+
+		/*
+		DefArena is the per-thread arena behind kStorage::Arena. It hands out
+		memory from a chain of chunks and keeps a list of the destructors it
+		must run, all of which it takes care of in its own destructor when the
+		thread exits.
+
+		ArenaSlot locates a given tag's default within the arena, constructing
+		it on first access.
+		*/
+		class DefArena {
+		public:
+			static constexpr std::size_t kChunkSize = 4096;
+
+			static auto ThisThread() noexcept -> DefArena&;
+
+			constexpr DefArena() noexcept = default;
+			DefArena(const DefArena&) = delete;
+			~DefArena();
+
+			auto allocate(std::size_t size, std::size_t align) -> void*;
+			void atExit(void(*destroy)(void*) noexcept, void* obj);
+			auto reserved() const noexcept -> std::size_t { return mReserved; }
+
+		private:
+			struct Chunk { Chunk* next; std::size_t size; };
+			struct Exit {
+				void(*destroy)(void*) noexcept;
+				void* obj;
+				Exit* next;
+			};
+
+			Chunk* mChunk = nullptr;
+			std::byte* mPos = nullptr;
+			std::byte* mEnd = nullptr;
+			Exit* mExits = nullptr;
+			std::size_t mReserved = 0;
+		};
+
+		template<typename Tag, typename Value>
+			struct ArenaSlot {
+				static auto Get() noexcept -> Value& {
+					auto p = tlPtr;
+					return p ? *p : Materialize();
+				 }
+				static auto Built() noexcept -> bool { return tlPtr; }
+
+			private:
+				static auto Materialize() noexcept -> Value&;
+				static void Destroy(void* obj) noexcept;
+
+				static thread_local Value* tlPtr;
+			};
+
+		/*
+		kLayout holds the entries of OPTARG_LAYOUT_FILE, if any, ending in
+		one with a null tag. Groups and tags are identified by their
+		typeid names.
+		*/
+		struct LayoutEntry {
+			const char* group;
+			const char* tag;
+			std::size_t size, align;
+		};
+		inline constexpr LayoutEntry kLayout[] = {
+		#ifdef OPTARG_LAYOUT_FILE
+			#define OPTARG_LAYOUT_ENTRY(group, tag, size, align) \
+				{group, tag, size, align},
+			#include OPTARG_LAYOUT_FILE
+			#undef OPTARG_LAYOUT_ENTRY
+		#endif
+			{nullptr, nullptr, 0, 1}
+		};
+
+		/*
+		GroupLayout assigns each tag in a group an offset within the group's
+		per-thread block as the tag registers itself, and builds blocks for
+		threads on demand. A thread's first block is tlHead. Any further
+		blocks (for tags registered after tlHead got built) are chained off
+		of it.
+
+		GroupSlot locates a given tag's default within its group's block.
+		*/
+		template<typename Group>
+			class GroupLayout {
+			public:
+				struct Slot { std::size_t index, offset; };
+				struct Block {
+					std::byte* base;
+					std::size_t first, end; // member indices built here
+					Block* next;
+				};
+
+				template<typename Value>
+					static auto Register(const char* key) -> Slot;
+				static auto Find(std::size_t index) noexcept -> std::byte*;
+
+				static thread_local Block tlHead;
+
+			private:
+				struct Member {
+					std::size_t offset;
+					void(*construct)(void*);
+					void(*destroy)(void*) noexcept;
+				};
+				struct Planned {
+					const char* key;
+					std::size_t size, align, offset;
+				};
+				struct State {
+					std::mutex mutex;
+					std::vector<Member> members;
+					std::vector<Planned> planned;
+					std::size_t size = 0, align = 1;
+				};
+
+				static auto GetState() -> State&;
+				static void Plan(State& st);
+				static auto Build(std::size_t first) noexcept -> Block;
+				static void Destroy(void*) noexcept;
+			};
+
+		template<typename Tag, typename Value, typename Group>
+			struct GroupSlot {
+				static auto Get() noexcept -> Value& {
+					static_cast<void>(&kRegistered);
+					auto slot = GetSlot();
+					auto& head = GroupLayout<Group>::tlHead;
+					auto base = slot.index < head.end ?
+						head.base : GroupLayout<Group>::Find(slot.index);
+					return *std::launder(
+						reinterpret_cast<Value*>(base + slot.offset)
+						);
+				 }
+				static auto Built() noexcept -> bool {
+					auto index = GetSlot().index;
+					auto p = &GroupLayout<Group>::tlHead;
+					for(; p && p->base; p = p->next) {
+						if(index >= p->first && index < p->end) {
+							return true;
+						}
+					}
+					return false;
+				 }
+
+			private:
+				static auto GetSlot() noexcept
+					-> typename GroupLayout<Group>::Slot;
+
+				// Registers every tag during static initialization, well
+				// ahead of any thread building its block.
+				static const bool kRegistered;
+			};
+	}
+
 	/**
 	Class hierarchy:
 		OptArgBase
@@ -220,9 +768,233 @@ namespace oarg {
 		associated conversion operator. These have been specialized to handle
 		CustomDef Value types seemlessly.
 	**/
+	/**
+	kRecOp
+
+	Identifies the kind of change an event in a recording (see OPTARG_RECORD)
+	or a USDT probe (see OPTARG_USDT) describes. Enter and Exit correspond to
+	the construction and destruction of a WithDefArg.
+	**/
+	enum class kRecOp: std::uint8_t { Set, SetRoot, Enter, Exit };
+	namespace detail {
+		template<typename Tag, typename Value>
+			void NotifyChange(const Value& v) noexcept;
+
+		// Defined in optarg_record.hpp.
+		template<typename Tag, typename Value>
+			void Record(kRecOp op, const Value& v) noexcept;
+
+		// Defined in optarg_layout.hpp.
+		template<typename Tag>
+			void NoteAccess() noexcept;
+		template<typename Tag, typename Value>
+			void Probe(kRecOp op, const Value& v) noexcept;
+
+		/*
+		TraceOp is called wherever a default changes, and feeds the change to
+		whichever of the recording and USDT probe hooks are enabled.
+		*/
+		template<typename Tag, typename Value>
+			inline void TraceOp(
+				[[maybe_unused]] kRecOp op, [[maybe_unused]] const Value& v
+				) noexcept
+			{
+			#if OPTARG_RECORD
+				Record<Tag>(op, v);
+			#endif
+			#if OPTARG_USDT
+				Probe<Tag>(op, v);
+			#endif
+			}
+
+		/*
+		GroupMembership holds the index of the ThreadGroup the calling thread
+		has joined (0 for none), and the version counter that ProcessRoot
+		caches are checked against. Anything that could change what some
+		thread resolves its default to bumps sVersion.
+		*/
+		struct GroupMembership {
+			static constexpr std::uint64_t kStale = ~std::uint64_t{0};
+
+			static inline thread_local std::size_t tlIndex = 0;
+			static inline std::atomic<std::uint64_t> sVersion{0};
+		};
+	}
+
+	/**
+	ThreadGroup
+
+	A ThreadGroup lets a pool of threads share defaults that differ from the
+	process root without each worker having to set them. Create one per pool,
+	have each worker join it once at start-up, and publish the pool's
+	defaults for any process_root tag (see TagTraits) with SetGroupDefault:
+
+		oarg::ThreadGroup ioPool;
+		oarg::OptArg<Timeout>::SetGroupDefault(ioPool, 30s);
+		...
+		// first thing in each I/O worker thread:
+		ioPool.join();
+
+	A read of the default then resolves in this order: the thread's own
+	default (from SetDefault or a WithDefArg), the override of the thread's
+	group if there is one, and finally the process root.
+
+	A thread belongs to at most one group at a time. Joining another replaces
+	the old membership, and Leave() drops it. Memberships and overrides refer
+	to a group by an index that is never reused, so destroying a ThreadGroup
+	is harmless: its threads simply go on seeing its last overrides.
+	**/
+	class ThreadGroup {
+	public:
+		ThreadGroup() noexcept;
+		ThreadGroup(const ThreadGroup&) = delete;
+
+		void join() const noexcept;
+		static void Leave() noexcept;
+
+		auto index() const noexcept -> std::size_t { return mIndex; }
+
+	private:
+		std::size_t mIndex;
+	};
+
+	namespace detail {
+
+		/*
+		ProcessRoot publishes the root default of a process_root tag, along
+		with a table of overrides indexed by ThreadGroup. tlOwn is true while
+		the calling thread has a default of its own, in which case it ignores
+		both.
+
+		Resolve() returns what the calling thread should read, going through
+		the tlView pointer cache. Whatever changes tlOwn must call SetOwn so
+		that the cache gets invalidated.
+
+		Inherited() returns what the calling thread would see without a
+		default of its own (its ThreadGroup's override or the root), bypassing
+		the cache.
+
+		For other tags, Get and Inherited simply return a default-constructed
+		Value.
+		*/
+		template<
+			typename Tag, typename Value,
+			bool Enabled = TagTraits<Tag>::kProcessRoot
+			>
+			struct ProcessRoot {
+				static auto Get() noexcept -> const Value& {
+					static const Value initial{};
+					return initial;
+				 }
+				static auto Inherited() noexcept -> const Value& {
+					return Get();
+				 }
+			};
+		template<typename Tag, typename Value>
+			struct ProcessRoot<Tag,Value,true> {
+				using TOwnFn = Value&(*)() noexcept;
+
+				static auto Get() noexcept -> const Value& {
+					return *sRoot.load(std::memory_order_acquire);
+				 }
+				static void Set(Value v);
+
+				static auto GetGroup(std::size_t index) noexcept
+					-> const Value&;
+				static auto Inherited() noexcept -> const Value& {
+					return GetGroup(GroupMembership::tlIndex);
+				 }
+				static void SetGroup(
+					std::size_t index, std::optional<Value> v);
+
+				static auto Resolve(TOwnFn own) noexcept -> const Value& {
+					if(tlSeen != GroupMembership::sVersion.load(
+						std::memory_order_acquire))
+					{
+						Refresh(own);
+					}
+					return *tlView;
+				 }
+				static void SetOwn(bool own) noexcept {
+					tlOwn = own;
+					tlSeen = GroupMembership::kStale;
+				 }
+
+				static thread_local bool tlOwn;
+				static inline const Value sInitial{};
+				static inline std::atomic<const Value*> sRoot{&sInitial};
+				static inline std::atomic<std::uint64_t> sWrites{0};
+
+			private:
+				using TTable = std::vector<const Value*>;
+				struct Published {
+					std::mutex mutex;
+					std::vector<std::unique_ptr<const Value>> values;
+					std::vector<std::unique_ptr<const TTable>> tables;
+				};
+
+				static auto ThePublished() -> Published&;
+				static void Refresh(TOwnFn own) noexcept;
+				static auto Override(std::size_t index) noexcept
+					-> const Value*;
+
+				static thread_local const Value* tlView;
+				static thread_local std::uint64_t tlSeen;
+				static inline std::atomic<const TTable*> sGroups{nullptr};
+			};
+
+		/*
+		GroupGen backs ResetGroup. Each group has a generation count that
+		ResetGroup bumps. Each tag of the group remembers, per thread, the
+		generation in which the thread last wrote its default (tlGen). If that
+		no longer matches, the thread's default is stale and reads fall back
+		to the inherited value (see ProcessRoot) until the next write.
+
+		GenSaver lets WithDefArgBase put tlGen back the way it found it, so
+		that the value it restores on exit is still treated as stale if it
+		was before.
+
+		For ungrouped tags, all of this compiles away.
+		*/
+		template<typename Group>
+			struct GroupEpoch {
+				static inline std::atomic<std::uint64_t> sGen{0};
+			};
+		template<
+			typename Tag,
+			typename Group = typename TagTraits<Tag>::TGroup,
+			typename Enable = void
+			>
+			struct GroupGen {
+				static constexpr auto Stale() noexcept -> bool {
+					return false;
+				 }
+			};
+		template<typename Tag, typename Group>
+			struct GroupGen<
+				Tag, Group, std::enable_if_t<!std::is_void_v<Group>>
+				>
+			{
+				static auto Current() noexcept -> std::uint64_t {
+					return GroupEpoch<Group>::sGen.load(
+						std::memory_order_acquire
+						);
+				 }
+				static auto Stale() noexcept -> bool {
+					return tlGen != Current();
+				 }
+
+				static inline thread_local std::uint64_t tlGen = 0;
+			};
+	}
 	template<typename OptArg, typename Tag, typename Value>
 		struct OptArgBase {
-			template<typename, typename, typename> friend class WithDefArg;
+			template<typename, typename> friend struct WithDefArgBase;
+
+			static_assert(
+				!TagTraits<Tag>::kRealTime || detail::kRealTimeSafe<Value>,
+				"real-time tag needs a trivially copyable value type"
+				);
 
 			using TOptVal = std::optional<Value>;
 
@@ -293,7 +1065,38 @@ namespace oarg {
 			**/
 			void reset() noexcept;
 
+			/**
+			RevertDefault class method:
+
+			This puts the calling thread's default back to what a newly
+			started thread would see: the value the default gets initialized
+			with or, for a process_root tag, whatever the thread inherits
+			from its ThreadGroup or the root. Like SetDefault, it is visible
+			to subscriptions and recordings. Test harnesses use it to give
+			each test on a reused thread a clean slate (see
+			optarg_testing.hpp).
+
+			IsOverridden class method:
+				Returns: whether the calling thread's default differs from what
+					RevertDefault would put back, or std::nullopt if that
+					cannot be told
+
+			The answer is always known for a process_root tag, since it comes
+			down to whether the thread has a default of its own. For other
+			tags, it takes comparing values, which needs the value type to
+			have an operator==.
+			**/
+			static void RevertDefault();
+			static auto IsOverridden() noexcept -> std::optional<bool>;
+
 		 protected:
+			using TRoot = detail::ProcessRoot<Tag,Value>;
+
+			static auto DefVal() noexcept -> Value&;
+			static auto EffVal() noexcept -> const Value&;
+			static auto OwnVal() noexcept -> Value&;
+			static auto Detach() -> Value&;
+
 			static thread_local Value tlDefVal;
 			TOptVal mOptVal;
 		};
@@ -314,12 +1117,70 @@ namespace oarg {
 			yourself. Normally, you would use WithDefArg to do so instead.
 			**/
 			static auto GetDefault() noexcept -> const TValue& {
-				return tlDefVal;
+				return EffVal();
 			 }
 			static void SetDefault(TValue&& v) noexcept {
-				tlDefVal = std::move(v);
+				OwnVal() = std::move(v);
+				detail::TraceOp<Tag>(kRecOp::Set, EffVal());
+				detail::NotifyChange<Tag>(GetDefault());
+			 }
+			static void SetDefault(const TValue& v) {
+				OwnVal() = v;
+				detail::TraceOp<Tag>(kRecOp::Set, EffVal());
+				detail::NotifyChange<Tag>(GetDefault());
+			 }
+
+			/**
+			MutDefault class method
+
+			This returns the calling thread's default by non-const reference,
+			for value types that carry state you need to update in place
+			(e.g. a random engine; see optarg_random.hpp). Like SetDefault, it
+			gives the thread a default of its own first if the tag has a
+			process_root. Note that changes made through the reference are
+			invisible to subscriptions and recordings.
+			**/
+			static auto MutDefault() -> TValue& {
+				return Detach();
+			 }
+
+			/**
+			GetRootDefault/SetRootDefault class methods
+
+			These access the process-wide root default of a tag declaring
+			process_root (see TagTraits). SetRootDefault will not compile for
+			any other tag, while GetRootDefault returns the value each thread
+			starts out with.
+			**/
+			static auto GetRootDefault() noexcept -> const TValue& {
+				return TRoot::Get();
+			 }
+			static void SetRootDefault(TValue v) {
+				TRoot::Set(std::move(v));
+				detail::TraceOp<Tag>(kRecOp::SetRoot, TRoot::Get());
+				detail::NotifyChange<Tag>(GetRootDefault());
+			 }
+
+			/**
+			GetGroupDefault/SetGroupDefault/ClearGroupDefault class methods
+
+			These manage the override a process_root tag has for the threads
+			of a given ThreadGroup. GetGroupDefault returns the root default
+			if the group has no override.
+			**/
+			static auto GetGroupDefault(const ThreadGroup& group) noexcept
+				-> const TValue&
+			 {
+				return TRoot::GetGroup(group.index());
+			 }
+			static void SetGroupDefault(const ThreadGroup& group, TValue v) {
+				TRoot::SetGroup(group.index(), std::move(v));
+				detail::NotifyChange<Tag>(GetGroupDefault(group));
+			 }
+			static void ClearGroupDefault(const ThreadGroup& group) {
+				TRoot::SetGroup(group.index(), std::nullopt);
+				detail::NotifyChange<Tag>(GetGroupDefault(group));
 			 }
-			static void SetDefault(const TValue& v) { tlDefVal = v; }
 
 			/**
 			value method:
@@ -352,16 +1213,19 @@ namespace oarg {
 				*/
 			 {
 				return this->defaults() ?
-					this->tlDefVal : std::move(*this->mOptVal);
+					this->EffVal() : std::move(*this->mOptVal);
 			 }
 			auto value() const& noexcept -> const TValue& {
-				return this->defaults() ? this->tlDefVal : *this->mOptVal;
+				return this->defaults() ? this->EffVal() : *this->mOptVal;
 			 }
 			operator TValue() && { return value(); }
 			operator const TValue&() const& noexcept { return value(); }
 
 		protected:
-			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::tlDefVal;
+			using typename OptArgBase<OptArg<Tag,Value>,Tag,Value>::TRoot;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::EffVal;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::OwnVal;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::Detach;
 		};
 	template<typename Tag, typename Value>
 		struct OptArg<
@@ -375,31 +1239,232 @@ namespace oarg {
 			using TTag = Tag;
 			using TValue = typename Value::type;
 			static auto GetDefault() noexcept -> const TValue& {
-				return tlDefVal.value;
+				return EffVal().value;
 			 }
 			static void SetDefault(TValue&& v) noexcept {
-				tlDefVal.value = std::move(v);
+				OwnVal().value = std::move(v);
+				detail::TraceOp<Tag>(kRecOp::Set, EffVal());
+				detail::NotifyChange<Tag>(GetDefault());
+			 }
+			static void SetDefault(const TValue& v) {
+				OwnVal().value = v;
+				detail::TraceOp<Tag>(kRecOp::Set, EffVal());
+				detail::NotifyChange<Tag>(GetDefault());
+			 }
+			static auto MutDefault() -> TValue& {
+				return Detach().value;
+			 }
+			static auto GetRootDefault() noexcept -> const TValue& {
+				return TRoot::Get().value;
+			 }
+			static void SetRootDefault(TValue v) {
+				TRoot::Set(Value{std::move(v)});
+				detail::TraceOp<Tag>(kRecOp::SetRoot, TRoot::Get());
+				detail::NotifyChange<Tag>(GetRootDefault());
+			 }
+			static auto GetGroupDefault(const ThreadGroup& group) noexcept
+				-> const TValue&
+			 {
+				return TRoot::GetGroup(group.index()).value;
+			 }
+			static void SetGroupDefault(const ThreadGroup& group, TValue v) {
+				TRoot::SetGroup(group.index(), Value{std::move(v)});
+				detail::NotifyChange<Tag>(GetGroupDefault(group));
+			 }
+			static void ClearGroupDefault(const ThreadGroup& group) {
+				TRoot::SetGroup(group.index(), std::nullopt);
+				detail::NotifyChange<Tag>(GetGroupDefault(group));
 			 }
-			static void SetDefault(const TValue& v) { tlDefVal.value = v; }
 			OptArg(const TValue& v):
 				OptArgBase<OptArg<Tag,Value>,Tag,Value>{Value{v}} {}
 			OptArg(TValue&& v):
 				OptArgBase<OptArg<Tag,Value>,Tag,Value>{Value{std::move(v)}} {}
 			auto value() && -> TValue {
 				return this->defaults() ?
-					this->tlDefVal.value : std::move(this->mOptVal->value);
+					this->EffVal().value : std::move(this->mOptVal->value);
 			}
 			auto value() const& noexcept -> const TValue& {
 				return this->defaults() ?
-					this->tlDefVal.value : this->mOptVal->value;
+					this->EffVal().value : this->mOptVal->value;
 			}
 			operator TValue() && { return value(); }
 			operator const TValue&() const& noexcept { return value(); }
 
 		protected:
-			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::tlDefVal;
+			using typename OptArgBase<OptArg<Tag,Value>,Tag,Value>::TRoot;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::EffVal;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::OwnVal;
+			using OptArgBase<OptArg<Tag,Value>,Tag,Value>::Detach;
 		};
 
+	/**
+	UseDefault class template
+
+	An OptArg only finds out at run-time whether the caller passed a value, so
+	every access to it tests defaults() first. When the callee is a template
+	anyway, you can let the compiler tell the two kinds of call apart instead,
+	by making the argument's type a template parameter that falls back to
+	UseDefault:
+
+		template<typename I = oarg::UseDefault<foo_i>>
+			void foo(I i = {}) {
+				std::cout << oarg::ArgValue<foo_i>(i) << '\n';
+			}
+
+		foo();   // I is UseDefault<foo_i>, so this just reads the default
+		foo(42); // I is int, so this never looks at the default at all
+
+	Each kind of call gets its own instantiation, neither of which contains
+	the test. Where the two paths need to differ beyond the value, you can
+	branch on kDefaulted<I> with if constexpr.
+
+	A UseDefault converts to an empty OptArg of the same tag, so you can still
+	pass one along to functions taking an OptArg.
+
+	kDefaulted variable template
+		true if Arg is a UseDefault (ignoring cv-qualifiers and references)
+
+	ArgValue function template
+		Returns: the default for Tag if arg is a UseDefault, arg.value() if it
+			is an OptArg, or else arg itself, unchanged
+	**/
+	template<typename Tag>
+		struct UseDefault {
+			using TTag = Tag;
+
+			template<typename Value, typename Enable>
+				constexpr operator OptArg<Tag,Value,Enable>() const noexcept {
+					return {};
+				}
+		};
+	namespace detail {
+		template<typename T>
+			struct IsUseDefault: std::false_type {};
+		template<typename Tag>
+			struct IsUseDefault<UseDefault<Tag>>: std::true_type {};
+
+		template<typename T>
+			struct IsOptArg: std::false_type {};
+		template<typename Tag, typename Value, typename Enable>
+			struct IsOptArg<OptArg<Tag,Value,Enable>>: std::true_type {};
+	}
+	template<typename Arg>
+		constexpr bool kDefaulted =
+			detail::IsUseDefault<std::remove_cv_t<std::remove_reference_t<Arg>>>
+				::value;
+	template<typename Tag, typename Arg>
+		constexpr auto ArgValue(Arg&& arg) noexcept(
+			!detail::IsOptArg<std::decay_t<Arg>>::value ||
+			std::is_lvalue_reference_v<Arg>
+			) -> decltype(auto);
+
+	namespace detail {
+
+		/*
+		DefSaver is where WithDefArgBase keeps the default it displaced. The
+		primary template simply embeds a copy. The specialization for tags with
+		a stack_depth pushes it onto a fixed-size per-thread stack instead.
+
+		Pushed() tells WithDefArgBase whether it should go ahead and modify the
+		default. It can only return false under kOverflow::Skip.
+		*/
+		template<typename Tag, typename Value, typename Enable = void>
+			struct DefSaver {
+				DefSaver(const Value& cur)
+					noexcept(std::is_nothrow_copy_constructible_v<Value>):
+					mSaved{cur} {}
+				static constexpr auto Pushed() noexcept -> bool { return true; }
+				void restore(Value& cur) noexcept { cur = std::move(mSaved); }
+
+			private:
+				Value mSaved;
+			};
+		template<typename Tag, typename Value>
+			struct DefSaver<
+				Tag, Value,
+				std::enable_if_t<(TagTraits<Tag>::kStackDepth > 0)>
+				>
+			{
+				DefSaver(const Value& cur)
+					noexcept(std::is_nothrow_copy_assignable_v<Value>);
+				static auto Pushed() noexcept -> bool {
+					return tlTop <= kDepth;
+				 }
+				void restore(Value& cur) noexcept;
+
+			private:
+				static constexpr std::size_t kDepth =
+					TagTraits<Tag>::kStackDepth;
+				static thread_local std::array<Value,kDepth> tlStack;
+				static thread_local std::size_t tlTop;
+			};
+
+		/*
+		RootSaver remembers whether the thread had its own default before a
+		WithDefArgBase gave it one, so that it can go back to following the
+		process root (or its group's default) afterwards. It is empty unless
+		the tag has process_root.
+		*/
+		template<
+			typename Tag, typename Value,
+			bool Enabled = TagTraits<Tag>::kProcessRoot
+			>
+			struct RootSaver {};
+		template<typename Tag, typename Value>
+			struct RootSaver<Tag,Value,true> {
+				RootSaver() noexcept:
+					mWasOwn{ProcessRoot<Tag,Value>::tlOwn} {}
+				~RootSaver() { ProcessRoot<Tag,Value>::SetOwn(mWasOwn); }
+
+			private:
+				bool mWasOwn;
+			};
+
+		template<typename Tag, typename Enable = void>
+			struct GenSaver {};
+		template<typename Tag>
+			struct GenSaver<
+				Tag,
+				std::enable_if_t<
+					!std::is_void_v<typename TagTraits<Tag>::TGroup>
+					>
+				>
+			{
+				GenSaver() noexcept: mGen{GroupGen<Tag>::tlGen} {}
+				~GenSaver() { GroupGen<Tag>::tlGen = mGen; }
+
+			private:
+				std::uint64_t mGen;
+			};
+
+		/*
+		AllocSaver makes the calling thread's counters for an alloc_stats tag
+		the ones the allocation hooks in optarg_allocstats.hpp charge to, for
+		as long as the WithDefArgBase lives. It is empty for other tags.
+		*/
+		struct AllocCounts; // defined in optarg_allocstats.hpp
+		struct AllocScope {
+			static inline thread_local AllocCounts* tlCurrent = nullptr;
+		};
+		template<typename Tag>
+			auto ThreadAllocCounts() noexcept -> AllocCounts&;
+
+		template<
+			typename Tag,
+			bool Enabled = TagTraits<Tag>::kAllocStats
+			>
+			struct AllocSaver {};
+		template<typename Tag>
+			struct AllocSaver<Tag,true> {
+				AllocSaver() noexcept: mOuter{AllocScope::tlCurrent} {
+					AllocScope::tlCurrent = &ThreadAllocCounts<Tag>();
+				 }
+				~AllocSaver() { AllocScope::tlCurrent = mOuter; }
+
+			private:
+				AllocCounts* mOuter;
+			};
+	}
 
 	/**
 	Class hierarchy:
@@ -437,8 +1502,18 @@ namespace oarg {
 	also a kBitwise::XOr for flipping bits.
 	**/
 	template<typename Tag, typename Value>
-		struct WithDefArgBase {
-			WithDefArgBase(const Value& v);
+		struct WithDefArgBase:
+			private detail::RootSaver<Tag,Value>,
+			private detail::GenSaver<Tag>,
+			private detail::AllocSaver<Tag>,
+			private detail::DefSaver<Tag,Value>
+		{
+			static_assert(
+				!TagTraits<Tag>::kRealTime || detail::kRealTimeSafe<Value>,
+				"real-time tag needs a trivially copyable value type"
+				);
+
+			WithDefArgBase(const Value& v) noexcept(kNoThrowCopy);
 			WithDefArgBase(Value&& v) noexcept;
 			template<typename MergeFn>
 				WithDefArgBase(const Value& v, MergeFn&& mergeFn);
@@ -449,9 +1524,22 @@ namespace oarg {
 			~WithDefArgBase() noexcept;
 
 		protected:
-			static auto tlDefVal() noexcept -> Value&;
+			static constexpr bool kNoThrowCopy =
+				std::is_nothrow_copy_constructible_v<Value> &&
+				std::is_nothrow_copy_assignable_v<Value>;
 
-			Value mSaved;
+			template<typename MergeFn>
+				static constexpr void CheckMergeFn() noexcept {
+					static_assert(
+						!TagTraits<Tag>::kRealTime ||
+						std::is_nothrow_invocable_v<
+							MergeFn&, Value&, const Value&
+							>,
+						"real-time tag needs a noexcept merge functor"
+						);
+				}
+			static auto tlDefVal() noexcept -> Value&;
+			static auto Detach() -> Value&;
 		};
 	template<
 		typename Tag,
@@ -489,14 +1577,526 @@ namespace oarg {
 	enum class kBitwise { Or, AndC, XOr };
 	template<typename Tag, typename Int = typename Tag::type>
 		struct WithDefFlags: WithDefArg<Tag,Int> {
-			static constexpr std::array<void(*)(Int&,Int), 2> kHandleOp = {
-				[](Int& dst, Int src) { dst |= src; }, // kBitwise::Or
-				[](Int& dst, Int src) { dst &= ~src; },  // kBitwise::AndC
-				[](Int& dst, Int src) { dst ^= src; }   // kBitwise::XOr
-				};
+			static constexpr std::array<void(*)(Int&,Int) noexcept, 3>
+				kHandleOp = {
+					[](Int& dst, Int src) noexcept { dst |= src; }, // Or
+					[](Int& dst, Int src) noexcept { dst &= ~src; }, // AndC
+					[](Int& dst, Int src) noexcept { dst ^= src; } // XOr
+					};
 			WithDefFlags(Int mask, kBitwise op = kBitwise::Or) noexcept;
 		};
 
+	/**
+	WarmDefaults function
+
+	This touches the calling thread's default for each of the tags you list,
+	forcing any lazy thread_local initialization to happen now rather than on
+	first use. It is mainly intended for real-time threads (see TagTraits),
+	which should call it before entering their real-time section:
+
+		void AudioThread() {
+			WarmDefaults<gain_f, pan_f, mute_b>();
+			for(;;) { ... }
+		}
+	**/
+	template<typename... Tags>
+		void WarmDefaults() noexcept;
+
+	/**
+	WarmThread function
+
+	This does what WarmDefaults does, but for every tag in the program that
+	declares prewarm (see TagTraits), so that you need not keep a list. Call
+	it first thing in each worker thread of a pool, or from whatever thread
+	start hook your pool offers:
+
+		pool.onThreadStart([] { oarg::WarmThread(); });
+
+	A tag gets on WarmThread's list during static initialization, provided
+	something in the program reads or writes its default.
+	**/
+	void WarmThread();
+
+	namespace detail {
+		/*
+		Prewarm keeps the list WarmThread goes through. A prewarm tag's
+		DefVal takes the address of PrewarmSlot::kRegistered, which is enough
+		to get it initialized (and so registered) at start-up without costing
+		anything at run-time.
+		*/
+		struct Prewarm {
+			using TWarmFn = void(*)() noexcept;
+
+			static auto Add(TWarmFn fn) -> bool;
+			static auto List() -> std::vector<TWarmFn>;
+
+		private:
+			struct State {
+				std::mutex mutex;
+				std::vector<TWarmFn> fns;
+			};
+			static auto TheState() -> State&;
+		};
+		template<typename Tag>
+			struct PrewarmSlot {
+				static void Warm() noexcept { WarmDefaults<Tag>(); }
+				static inline const bool kRegistered = Prewarm::Add(&Warm);
+			};
+	}
+
+	/**
+	ResetGroup function
+
+	This sends every tag declaring the given group (see TagTraits) back to its
+	inherited default on every thread at once: the process root (or ThreadGroup
+	override) for process_root tags, and the initial default otherwise. It is
+	meant for when a subsystem restarts or a test ends:
+
+		struct storage_grp {};
+		struct cache_mb { using type = int; using group = storage_grp; };
+		...
+		oarg::ResetGroup<storage_grp>();
+
+	The cost is a single atomic increment, however many tags and threads
+	there are. No thread's storage actually gets touched. Instead, each read of
+	a grouped tag compares the generation in which the thread last wrote the
+	default against the group's, and ignores the thread's value if it is
+	stale. The next write on that thread starts afresh.
+
+	A WithDefArg that is active on some thread during a reset still restores
+	what it displaced when it exits, but since that too predates the reset,
+	it stays ignored.
+	**/
+	template<typename Group>
+		void ResetGroup() noexcept;
+
+	/**
+	Config structs
+
+	If you already keep your settings in an aggregate struct, you need not
+	write a tag for each of its fields by hand. Field<&Config::member> is a
+	ready-made tag for one field, with the field's type as its value type.
+
+		struct Config {
+			int port = 8080;
+			std::string host = "localhost";
+			double timeout_s = 2.5;
+		};
+		void Listen(oarg::OptArg<oarg::Field<&Config::port>> port = {});
+
+	The OPTARG_FIELD macro declares a named tag for a field instead, which is
+	shorter to spell and gives the tag a name for RegisterTag:
+
+		namespace cfg {
+			OPTARG_FIELD(Config, port);
+			OPTARG_FIELD(Config, host);
+		}
+		void Listen(oarg::OptArg<cfg::port> port = {});
+
+	The field tags of a struct do not get storage of their own. Each thread
+	instead keeps one whole Config (the default of the ConfigOf<Config> tag),
+	value-initialized so that the default member initializers give each field
+	its initial default, and a field tag's default is simply that member. So
+	all of a struct's fields sit together in memory, and you can get or set
+	every one of them at once with a plain struct copy:
+
+		Config snapshot = oarg::GetConfig<Config>();
+		oarg::SetConfig(snapshot);
+		oarg::WithDefArg<oarg::ConfigOf<Config>> scoped{snapshot};
+
+	Field tags cannot use the process_root or group settings, and neither can
+	ConfigOf. A storage setting on a field tag is ignored, since the field
+	lives wherever its ConfigOf does.
+	**/
+	template<typename Config>
+		struct ConfigOf { using type = Config; };
+	template<auto Member>
+		struct Field;
+	template<typename Config, typename T, T Config::*Member>
+		struct Field<Member> {
+			using type = T;
+			using config = Config;
+			static constexpr auto field = Member;
+		};
+	#define OPTARG_FIELD(Config, member) \
+		struct member: ::oarg::Field<&Config::member> { \
+			static constexpr const char* name = #member; \
+		}
+	template<typename Config>
+		auto GetConfig() noexcept -> const Config&;
+	template<typename Config>
+		void SetConfig(const Config& config);
+
+	namespace detail {
+		template<typename Tag, typename Enable = void>
+			struct TagField: std::false_type {};
+		template<typename Tag>
+			struct TagField<Tag, std::void_t<typename Tag::config>>:
+				std::true_type {};
+
+		template<typename Tag>
+			constexpr bool kPlainStorage =
+				!TagTraits<Tag>::kProcessRoot &&
+				std::is_void_v<typename TagTraits<Tag>::TGroup>;
+
+		// FieldSlot locates a field tag's default within its ConfigOf's.
+		template<typename Tag>
+			struct FieldSlot {
+				using TConfig = typename Tag::config;
+
+				static_assert(
+					kPlainStorage<Tag> && kPlainStorage<ConfigOf<TConfig>>,
+					"field tags cannot use process_root or group"
+					);
+
+				static auto Get() noexcept -> typename Tag::type& {
+					return OptArg<ConfigOf<TConfig>>::MutDefault().*Tag::field;
+				 }
+				static auto Initial() noexcept -> const typename Tag::type& {
+					return ProcessRoot<ConfigOf<TConfig>,TConfig>::Get()
+						.*Tag::field;
+				 }
+			};
+
+		/*
+		Touched tells whether the calling thread has constructed its default
+		for Tag yet, which can only fail to be the case with arena storage.
+		Code that merely inspects defaults checks this first, so as not to be
+		what materializes them.
+		*/
+		template<typename Tag>
+			auto Touched() noexcept -> bool {
+				using TGroup = typename TagTraits<Tag>::TGroup;
+				if constexpr(TagField<Tag>::value) {
+					return Touched<ConfigOf<typename Tag::config>>();
+				}
+				else if constexpr(TagTraits<Tag>::kStoreIn != kStorage::Arena) {
+					return true;
+				}
+				else if constexpr(std::is_void_v<TGroup>) {
+					return ArenaSlot<Tag,typename Tag::type>::Built();
+				}
+				else {
+					return GroupSlot<Tag,typename Tag::type,TGroup>::Built();
+				}
+			}
+	}
+
+	/**
+	Subscribe function
+
+	Code that precomputes something from a default (say, a connection pool
+	sized according to some max_conns tag) can use this to hear about changes
+	to it, provided the tag declares
+
+		static constexpr bool notify = true;
+
+	You pass Subscribe a callback taking the new value and the std::thread::id
+	of the thread that set it. You can also pass a thread ID as a 2nd argument
+	if you only care about what one particular thread does. What you get back
+	is a Subscription handle, which unsubscribes when destroyed.
+
+		auto sub = Subscribe<max_conns_i>(
+			[&pool](const int& n, std::thread::id) { pool.resize(n); }
+			);
+
+	Note that SetDefault never calls subscribers directly. Instead, it pushes a
+	copy of the new value onto a lock-free queue, and only if the tag has any
+	subscribers at the time. (Otherwise, the cost is a single relaxed atomic
+	load.) Callbacks then run when some thread of your choosing calls
+	DeliverChanges, typically from an event loop or timer.
+
+	DeliverChanges coalesces the queue as it goes. If a thread set the same tag
+	several times since the last delivery, only the latest value is passed on.
+	It returns the number of changes it delivered.
+
+	Delivery for a given tag is serialized with subscribing and unsubscribing,
+	so once a Subscription has been destroyed, its callback will not be called
+	again. A callback may safely destroy its own Subscription.
+
+	WithDefArg does not generate change notifications, since its changes are
+	scoped to one thread by design. If the queue cannot allocate memory to
+	record a change, that change is dropped.
+	**/
+	class Subscription;
+	template<typename Tag, typename Fn>
+		auto Subscribe(Fn&& fn, std::optional<std::thread::id> thread = {})
+			-> Subscription;
+	auto DeliverChanges() -> std::size_t;
+
+	class Subscription {
+	public:
+		Subscription() noexcept = default;
+		Subscription(const Subscription&) = delete;
+		Subscription(Subscription&& s) noexcept;
+		~Subscription();
+		auto operator= (Subscription&& s) noexcept -> Subscription&;
+
+		void reset();
+
+	private:
+		template<typename Tag, typename Fn>
+			friend auto Subscribe(Fn&&, std::optional<std::thread::id>)
+				-> Subscription;
+
+		Subscription(void(*cancel)(void*), std::shared_ptr<void> entry)
+			noexcept;
+
+		void(*mCancel)(void*) = nullptr;
+		std::shared_ptr<void> mEntry;
+	};
+
+	namespace detail {
+
+		/*
+		ChangeEvent is a node in the lock-free stack that SetDefault pushes
+		onto. TagChanges keeps the subscribers of one tag.
+		*/
+		struct ChangeEvent {
+			ChangeEvent* next = nullptr;
+			const void* key;
+			std::thread::id thread = std::this_thread::get_id();
+
+			ChangeEvent(const void* key) noexcept: key{key} {}
+			virtual ~ChangeEvent() = default;
+			virtual void deliver() = 0;
+		};
+		inline auto PendingChanges() noexcept -> std::atomic<ChangeEvent*>& {
+			static std::atomic<ChangeEvent*> pending{nullptr};
+			return pending;
+		}
+
+		template<typename Tag>
+			struct TagChanges {
+				using TValue = typename OptArg<Tag>::TValue;
+				struct Entry {
+					std::function<void(const TValue&, std::thread::id)> fn;
+					std::optional<std::thread::id> thread;
+					bool active = true;
+				};
+				struct Event: ChangeEvent {
+					TValue value;
+					Event(const TValue& v):
+						ChangeEvent{&sCount}, value{v} {}
+					void deliver() override;
+				};
+
+				static auto Add(std::shared_ptr<Entry> entry) -> void;
+				static void Cancel(void* entry);
+
+				static inline std::atomic<std::size_t> sCount{0};
+
+			private:
+				struct State {
+					std::recursive_mutex mutex;
+					std::vector<std::shared_ptr<Entry>> entries;
+				};
+				static auto GetState() -> State&;
+			};
+	}
+
+	/**
+	Tag registry
+
+	Tools that need to walk the tags of a running program (see optarg_admin.hpp
+	for one) can find them here, provided each tag was registered at namespace
+	scope in some source file:
+
+		struct max_conns_i {
+			using type = int;
+			static constexpr bool process_root = true;
+		};
+		OPTARG_REGISTER(max_conns_i)
+
+	The tag's name is taken from a
+
+		static constexpr const char* name = "max_conns";
+
+	if it declares one, or the spelling of the macro argument otherwise.
+	Registering a tag more than once (e.g. from a header included in multiple
+	source files) is harmless.
+
+	How OPTARG_REGISTER goes about it depends on the OPTARG_SECTION_REGISTRY
+	macro. By default on ELF platforms, it runs no code at all: the tag's
+	TagInfo gets built at compile time, and a pointer to it goes into a linker
+	section called optarg_tags, which the linker gathers into one array for
+	RegisteredTags to read. So registering thousands of tags adds nothing to
+	start-up, and the registry is complete even while other static
+	initializers are still running. Otherwise, each OPTARG_REGISTER runs a
+	static initializer that calls RegisterTag. You may also call RegisterTag
+	yourself at any time, e.g. for a tag whose name is only known at run-time.
+
+	TagInfo:
+		Every registered tag gets one of these. The type field identifies the
+		tag struct, and the size and align fields describe its value type.
+		The function pointers let you work with the tag's defaults as text,
+		using the value type's stream operators:
+
+		format:
+			Writes out the calling thread's current default, or the root
+			default if you pass true. Returns std::nullopt if the value type
+			has no operator<<.
+		parse:
+			Reads a value and publishes it as the tag's root default. Returns
+			false if the tag is not a process_root tag, the value type has no
+			operator>>, or the text does not parse completely. (A std::string
+			value simply takes the whole text.)
+		rootWrites:
+			How many times a root default has been published.
+		subscribers:
+			How many Subscriptions (see Subscribe) the tag currently has.
+		overridden/revert:
+			Call OptArg's IsOverridden and RevertDefault for the tag.
+
+		The remaining fields tell you what the tag costs each thread:
+
+		storage:
+			Where the default lives (see TagTraits).
+		tlsBytes:
+			The static TLS the default takes: size for kStorage::TLS, a
+			pointer for kStorage::Arena, and nothing for grouped or field
+			tags, which share storage with others. This leaves out the few
+			bytes of bookkeeping some tag settings add.
+		heapBytes:
+			The heap memory owned by the calling thread's current default, or
+			std::nullopt if that cannot be measured. It can be for value types
+			with data(), capacity() and a value_type (strings, vectors, etc.).
+			Such a value counts as owning capacity() elements unless data()
+			points into the value itself, as with a short string. An arena
+			default the thread has not yet touched counts as 0. (For a
+			process_root tag that the thread has not overridden, this is the
+			shared root's memory.)
+	RegisteredTags function:
+		Returns all the tags registered so far, each once. Those in the
+		optarg_tags section come first, in link order, followed by the rest
+		in registration order.
+
+	ThreadFootprint:
+		tls:
+			The sum of tlsBytes over all registered tags.
+		arena:
+			The memory the calling thread's default arena (see TagTraits'
+			storage setting) has reserved so far, including grouped tags.
+		heap:
+			The sum of the measurable heapBytes over all registered tags.
+	GetThreadFootprint function:
+		Returns: a ThreadFootprint for the calling thread
+
+		Unregistered tags are not counted, except in the arena figure.
+	**/
+	struct TagInfo {
+		const char* name;
+		const std::type_info* type;
+		std::size_t size, align;
+		bool processRoot;
+		std::optional<std::string>(*format)(bool root);
+		bool(*parse)(std::string_view text);
+		std::uint64_t(*rootWrites)() noexcept;
+		std::size_t(*subscribers)() noexcept;
+		std::optional<bool>(*overridden)() noexcept;
+		void(*revert)();
+		kStorage storage;
+		std::size_t tlsBytes;
+		std::optional<std::size_t>(*heapBytes)();
+	};
+	auto RegisteredTags() -> std::vector<const TagInfo*>;
+	struct ThreadFootprint {
+		std::size_t tls, arena, heap;
+	};
+	auto GetThreadFootprint() -> ThreadFootprint;
+	template<typename Tag>
+		auto RegisterTag(const char* name) -> const TagInfo&;
+
+	#define OPTARG_CONCAT_(a, b) a##b
+	#define OPTARG_CONCAT(a, b) OPTARG_CONCAT_(a, b)
+	#define OPTARG_REGISTER(Tag) OPTARG_REGISTER_(Tag, __COUNTER__)
+	#if OPTARG_SECTION_REGISTRY
+		#define OPTARG_REGISTER_(Tag, n) \
+			static constexpr ::oarg::TagInfo OPTARG_CONCAT(optargTagInfo, n) = \
+				::oarg::detail::MakeTagInfo<Tag>(#Tag); \
+			[[maybe_unused]] __attribute__((section("optarg_tags"), used)) \
+				static const ::oarg::TagInfo* const \
+					OPTARG_CONCAT(optargRegistered, n) = \
+						&OPTARG_CONCAT(optargTagInfo, n);
+	#else
+		#define OPTARG_REGISTER_(Tag, n) \
+			[[maybe_unused]] static const ::oarg::TagInfo& \
+				OPTARG_CONCAT(optargRegistered, n) = \
+					::oarg::RegisterTag<Tag>(#Tag);
+	#endif
+
+	namespace detail {
+		auto TagRegistry()
+			-> std::pair<std::mutex&, std::vector<const TagInfo*>&>;
+		template<typename Tag>
+			constexpr auto MakeTagInfo(const char* name) -> TagInfo;
+
+	#if OPTARG_SECTION_REGISTRY
+		// The linker defines these if anything went into optarg_tags.
+		extern "C" {
+			extern const TagInfo* const __start_optarg_tags[]
+				__attribute__((weak, visibility("hidden")));
+			extern const TagInfo* const __stop_optarg_tags[]
+				__attribute__((weak, visibility("hidden")));
+		}
+	#endif
+
+		template<typename Tag, typename Enable = void>
+			struct TagName {
+				static constexpr auto Get(const char* fallback) noexcept
+					-> const char* { return fallback; }
+			};
+		template<typename Tag>
+			struct TagName<Tag, std::void_t<decltype(Tag::name)>> {
+				static constexpr auto Get(const char*) noexcept
+					-> const char* { return Tag::name; }
+			};
+
+		template<typename T, typename Enable = void>
+			struct CanWrite: std::false_type {};
+		template<typename T>
+			struct CanWrite<
+				T, std::void_t<decltype(
+					std::declval<std::ostream&>() << std::declval<const T&>()
+					)>
+				>: std::true_type {};
+		template<typename T, typename Enable = void>
+			struct CanRead: std::false_type {};
+		template<typename T>
+			struct CanRead<
+				T, std::void_t<decltype(
+					std::declval<std::istream&>() >> std::declval<T&>()
+					)>
+				>: std::true_type {};
+		template<typename T, typename Enable = void>
+			struct CanCompare: std::false_type {};
+		template<typename T>
+			struct CanCompare<
+				T, std::enable_if_t<std::is_base_of_v<CustomDefBase, T>>
+				>: CanCompare<decltype(T::value)> {};
+		template<typename T>
+			struct CanCompare<
+				T, std::enable_if_t<
+					!std::is_base_of_v<CustomDefBase, T> &&
+					std::is_convertible_v<
+						decltype(std::declval<const T&>() ==
+							std::declval<const T&>()),
+						bool
+						>
+					>
+				>: std::true_type {};
+		template<typename T, typename Enable = void>
+			struct CanMeasure: std::false_type {};
+		template<typename T>
+			struct CanMeasure<
+				T, std::void_t<
+					typename T::value_type,
+					decltype(std::declval<const T&>().data()),
+					decltype(std::declval<const T&>().capacity())
+					>
+				>: std::true_type {};
+	}
+
 	//==== Template Implementation =============================================
 
 	//---- OptArgBase ----------------------------------------------------------
@@ -505,55 +2105,978 @@ namespace oarg {
 		void OptArgBase<C,T,V>::reset() noexcept {
 			return mOptVal.reset();
 		}
+	template<typename C, typename T, typename V>
+		void OptArgBase<C,T,V>::RevertDefault() {
+			if constexpr(TagTraits<T>::kProcessRoot) {
+				TRoot::SetOwn(false);
+			}
+			else if(detail::Touched<T>()) {
+				if constexpr(detail::TagField<T>::value) {
+					OwnVal() = detail::FieldSlot<T>::Initial();
+				}
+				else {
+					OwnVal() = TRoot::Get();
+				}
+			}
+			else {
+				return;
+			}
+			detail::TraceOp<T>(kRecOp::Set, EffVal());
+			detail::NotifyChange<T>(C::GetDefault());
+		}
+	template<typename C, typename T, typename V>
+		auto OptArgBase<C,T,V>::IsOverridden() noexcept
+			-> std::optional<bool>
+		{
+			if(detail::GroupGen<T>::Stale()) {
+				return false;
+			}
+			if constexpr(TagTraits<T>::kProcessRoot) {
+				return TRoot::tlOwn;
+			}
+			else if(!detail::Touched<T>()) {
+				return false;
+			}
+			else if constexpr(!detail::CanCompare<V>::value) {
+				return std::nullopt;
+			}
+			else if constexpr(detail::TagField<T>::value) {
+				return !(DefVal() == detail::FieldSlot<T>::Initial());
+			}
+			else if constexpr(std::is_base_of_v<CustomDefBase, V>) {
+				return !(DefVal().value == TRoot::Get().value);
+			}
+			else {
+				return !(DefVal() == TRoot::Get());
+			}
+		}
+	template<typename C, typename T, typename V>
+		auto OptArgBase<C,T,V>::DefVal() noexcept -> V& {
+			if constexpr(TagTraits<T>::kPrewarm) {
+				static_cast<void>(&detail::PrewarmSlot<T>::kRegistered);
+			}
+			if constexpr(detail::TagField<T>::value) {
+				return detail::FieldSlot<T>::Get();
+			}
+			else if constexpr(TagTraits<T>::kStoreIn == kStorage::Arena) {
+				using G = typename TagTraits<T>::TGroup;
+				if constexpr(std::is_void_v<G>) {
+					return detail::ArenaSlot<T,V>::Get();
+				}
+				else {
+					return detail::GroupSlot<T,V,G>::Get();
+				}
+			}
+			else {
+				return tlDefVal;
+			}
+		}
+	template<typename C, typename T, typename V>
+		auto OptArgBase<C,T,V>::EffVal() noexcept -> const V& {
+		#if OPTARG_LAYOUT_PROFILE
+			detail::NoteAccess<T>();
+		#endif
+			if(detail::GroupGen<T>::Stale()) {
+				return TRoot::Inherited();
+			}
+			if constexpr(TagTraits<T>::kProcessRoot) {
+				return TRoot::Resolve(&DefVal);
+			}
+			else {
+				return DefVal();
+			}
+		}
+	template<typename C, typename T, typename V>
+		auto OptArgBase<C,T,V>::OwnVal() noexcept -> V& {
+			using TGen = detail::GroupGen<T>;
+			if constexpr(!std::is_void_v<typename TagTraits<T>::TGroup>) {
+				TGen::tlGen = TGen::Current();
+			}
+			if constexpr(TagTraits<T>::kProcessRoot) {
+				if(!TRoot::tlOwn) {
+					TRoot::SetOwn(true);
+				}
+			}
+			return DefVal();
+		}
+	template<typename C, typename T, typename V>
+		auto OptArgBase<C,T,V>::Detach() -> V& {
+			using TGen = detail::GroupGen<T>;
+			if constexpr(!std::is_void_v<typename TagTraits<T>::TGroup>) {
+				auto gen = TGen::Current();
+				if(TGen::tlGen != gen) {
+					if constexpr(TagTraits<T>::kProcessRoot) {
+						TRoot::SetOwn(false);
+					}
+					else {
+						DefVal() = TRoot::Get();
+					}
+					TGen::tlGen = gen;
+				}
+			}
+			if constexpr(TagTraits<T>::kProcessRoot) {
+				if(!TRoot::tlOwn) {
+					DefVal() = TRoot::Resolve(&DefVal);
+					TRoot::SetOwn(true);
+				}
+			}
+			return DefVal();
+		}
 	template<typename C, typename T, typename V>
 		thread_local V OptArgBase<C,T,V>::tlDefVal{};
 
+	//---- ProcessRoot ---------------------------------------------------------
+
+	template<typename T, typename V>
+		thread_local bool detail::ProcessRoot<T,V,true>::tlOwn = false;
+	template<typename T, typename V>
+		thread_local const V* detail::ProcessRoot<T,V,true>::tlView = nullptr;
+	template<typename T, typename V>
+		thread_local std::uint64_t detail::ProcessRoot<T,V,true>::tlSeen =
+			GroupMembership::kStale;
+	template<typename T, typename V>
+		auto detail::ProcessRoot<T,V,true>::ThePublished() -> Published& {
+			static Published published;
+			return published;
+		}
+	template<typename T, typename V>
+		void detail::ProcessRoot<T,V,true>::Set(V v) {
+			auto root = std::make_unique<const V>(std::move(v));
+			auto& pub = ThePublished();
+			std::lock_guard<std::mutex> lock{pub.mutex};
+			pub.values.reserve(pub.values.size() + 1);
+			sRoot.store(root.get(), std::memory_order_release);
+			pub.values.push_back(std::move(root));
+			sWrites.fetch_add(1, std::memory_order_relaxed);
+			GroupMembership::sVersion.fetch_add(1, std::memory_order_release);
+		}
+	template<typename T, typename V>
+		auto detail::ProcessRoot<T,V,true>::Override(std::size_t index)
+			noexcept -> const V*
+		{
+			auto table = sGroups.load(std::memory_order_acquire);
+			return table && index < table->size() ? (*table)[index] : nullptr;
+		}
+	template<typename T, typename V>
+		auto detail::ProcessRoot<T,V,true>::GetGroup(std::size_t index)
+			noexcept -> const V&
+		{
+			auto p = Override(index);
+			return p ? *p : Get();
+		}
+	template<typename T, typename V>
+		void detail::ProcessRoot<T,V,true>::SetGroup(
+			std::size_t index, std::optional<V> v)
+		{
+			std::unique_ptr<const V> value;
+			if(v) {
+				value = std::make_unique<const V>(std::move(*v));
+			}
+			auto& pub = ThePublished();
+			std::lock_guard<std::mutex> lock{pub.mutex};
+			auto table = std::make_unique<TTable>();
+			if(auto old = sGroups.load(std::memory_order_relaxed)) {
+				*table = *old;
+			}
+			if(table->size() <= index) {
+				table->resize(index + 1);
+			}
+			(*table)[index] = value.get();
+			pub.tables.reserve(pub.tables.size() + 1);
+			if(value) {
+				pub.values.reserve(pub.values.size() + 1);
+			}
+			sGroups.store(table.get(), std::memory_order_release);
+			pub.tables.push_back(std::move(table));
+			if(value) {
+				pub.values.push_back(std::move(value));
+			}
+			GroupMembership::sVersion.fetch_add(1, std::memory_order_release);
+		}
+	template<typename T, typename V>
+		void detail::ProcessRoot<T,V,true>::Refresh(TOwnFn own) noexcept {
+			auto version =
+				GroupMembership::sVersion.load(std::memory_order_acquire);
+			if(tlOwn) {
+				tlView = &own();
+			}
+			else {
+				auto p = Override(GroupMembership::tlIndex);
+				tlView = p ? p : &Get();
+			}
+			tlSeen = version;
+		}
+
+	//---- ThreadGroup ---------------------------------------------------------
+
+	inline ThreadGroup::ThreadGroup() noexcept {
+			static std::atomic<std::size_t> count{0};
+			mIndex = count.fetch_add(1, std::memory_order_relaxed) + 1;
+		}
+	inline void ThreadGroup::join() const noexcept {
+			detail::GroupMembership::tlIndex = mIndex;
+			detail::GroupMembership::sVersion.fetch_add(
+				1, std::memory_order_release
+				);
+		}
+	inline void ThreadGroup::Leave() noexcept {
+			if(detail::GroupMembership::tlIndex != 0) {
+				detail::GroupMembership::tlIndex = 0;
+				detail::GroupMembership::sVersion.fetch_add(
+					1, std::memory_order_release
+					);
+			}
+		}
+
+	//---- DefArena ------------------------------------------------------------
+
+	inline auto detail::DefArena::ThisThread() noexcept -> DefArena& {
+			static thread_local DefArena arena;
+			return arena;
+		}
+	inline detail::DefArena::~DefArena() {
+			for(auto p = mExits; p; p = p->next) {
+				p->destroy(p->obj);
+			}
+			while(mChunk) {
+				auto next = mChunk->next;
+				::operator delete(static_cast<void*>(mChunk));
+				mChunk = next;
+			}
+			mPos = mEnd = nullptr;
+			mExits = nullptr;
+			mReserved = 0;
+		}
+	inline auto detail::DefArena::allocate(
+		std::size_t size, std::size_t align
+		) -> void*
+		{
+			auto misalign = reinterpret_cast<std::uintptr_t>(mPos) % align;
+			auto pad = misalign ? align - misalign : 0;
+			if(!mPos || static_cast<std::size_t>(mEnd - mPos) < pad + size) {
+				auto hdr = (sizeof(Chunk) + alignof(std::max_align_t) - 1) /
+					alignof(std::max_align_t) * alignof(std::max_align_t);
+				auto need = hdr + size + align;
+				auto n = need > kChunkSize ? need : kChunkSize;
+				auto chunk = static_cast<Chunk*>(::operator new(n));
+				*chunk = Chunk{mChunk, n};
+				mChunk = chunk;
+				mReserved += n;
+				mPos = reinterpret_cast<std::byte*>(chunk) + hdr;
+				mEnd = reinterpret_cast<std::byte*>(chunk) + n;
+				misalign = reinterpret_cast<std::uintptr_t>(mPos) % align;
+				pad = misalign ? align - misalign : 0;
+			}
+			auto p = mPos + pad;
+			mPos = p + size;
+			return p;
+		}
+	inline void detail::DefArena::atExit(
+		void(*destroy)(void*) noexcept, void* obj
+		)
+		{
+			auto p = static_cast<Exit*>(allocate(sizeof(Exit), alignof(Exit)));
+			mExits = new(p) Exit{destroy, obj, mExits};
+		}
+
+	//---- ArenaSlot -----------------------------------------------------------
+
+	template<typename T, typename V>
+		thread_local V* detail::ArenaSlot<T,V>::tlPtr = nullptr;
+	template<typename T, typename V>
+		auto detail::ArenaSlot<T,V>::Materialize() noexcept -> V& {
+			auto& arena = DefArena::ThisThread();
+			auto p = new(arena.allocate(sizeof(V), alignof(V))) V{};
+			if constexpr(!std::is_trivially_destructible_v<V>) {
+				arena.atExit(&Destroy, p);
+			}
+			return *(tlPtr = p);
+		}
+	template<typename T, typename V>
+		void detail::ArenaSlot<T,V>::Destroy(void* obj) noexcept {
+			static_cast<V*>(obj)->~V();
+			tlPtr = nullptr;
+		}
+
+	//---- GroupLayout ---------------------------------------------------------
+
+	template<typename G>
+		thread_local typename detail::GroupLayout<G>::Block
+			detail::GroupLayout<G>::tlHead{};
+	template<typename G>
+		auto detail::GroupLayout<G>::GetState() -> State& {
+			static State state;
+			static const bool planned = (Plan(state), true);
+			static_cast<void>(planned);
+			return state;
+		}
+	template<typename G>
+		void detail::GroupLayout<G>::Plan(State& st) {
+			auto group = typeid(G).name();
+			for(auto e = kLayout; e->tag; ++e) {
+				if(std::strcmp(e->group, group) != 0) {
+					continue;
+				}
+				auto offset = (st.size + e->align - 1) / e->align * e->align;
+				st.size = offset + e->size;
+				if(st.align < e->align) {
+					st.align = e->align;
+				}
+				st.planned.push_back(
+					Planned{e->tag, e->size, e->align, offset}
+					);
+			}
+		}
+	template<typename G> template<typename V>
+		auto detail::GroupLayout<G>::Register(const char* key) -> Slot {
+			auto& st = GetState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			std::optional<std::size_t> planned;
+			for(auto& p: st.planned) {
+				if(std::strcmp(p.key, key) == 0) {
+					if(p.size == sizeof(V) && p.align == alignof(V)) {
+						planned = p.offset;
+					}
+					break;
+				}
+			}
+			auto offset = planned.value_or(
+				(st.size + alignof(V) - 1) / alignof(V) * alignof(V)
+				);
+			if(!planned) {
+				st.size = offset + sizeof(V);
+				if(st.align < alignof(V)) {
+					st.align = alignof(V);
+				}
+			}
+			void(*destroy)(void*) noexcept = nullptr;
+			if constexpr(!std::is_trivially_destructible_v<V>) {
+				destroy = [](void* p) noexcept { static_cast<V*>(p)->~V(); };
+			}
+			st.members.push_back(Member{
+				offset, [](void* p) { new(p) V{}; }, destroy
+				});
+			return Slot{st.members.size() - 1, offset};
+		}
+	template<typename G>
+		auto detail::GroupLayout<G>::Build(std::size_t first) noexcept
+			-> Block
+		{
+			// Copy what we need so that no lock is held while constructing
+			// (in case a constructor reads some other default).
+			auto& st = GetState();
+			std::unique_lock<std::mutex> lock{st.mutex};
+			std::vector<Member> members(
+				st.members.begin() + first, st.members.end()
+				);
+			auto size = st.size, align = st.align;
+			lock.unlock();
+
+			auto base = static_cast<std::byte*>(
+				DefArena::ThisThread().allocate(size ? size : 1, align)
+				);
+			for(auto& m: members) {
+				m.construct(base + m.offset);
+			}
+			return Block{base, first, first + members.size(), nullptr};
+		}
+	template<typename G>
+		auto detail::GroupLayout<G>::Find(std::size_t index) noexcept
+			-> std::byte*
+		{
+			auto& head = tlHead;
+			if(!head.base) {
+				head = Build(0);
+				DefArena::ThisThread().atExit(&Destroy, nullptr);
+				if(index < head.end) {
+					return head.base;
+				}
+			}
+			auto end = head.end;
+			for(auto p = head.next; p; p = p->next) {
+				if(index >= p->first && index < p->end) {
+					return p->base;
+				}
+				end = p->end;
+			}
+			auto& arena = DefArena::ThisThread();
+			auto p = new(arena.allocate(sizeof(Block), alignof(Block)))
+				Block{Build(end)};
+			auto tail = &head;
+			while(tail->next) {
+				tail = tail->next;
+			}
+			tail->next = p;
+			return p->base;
+		}
+	template<typename G>
+		void detail::GroupLayout<G>::Destroy(void*) noexcept {
+			auto& st = GetState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			for(auto p = &tlHead; p; p = p->next) {
+				for(auto i = p->end; i-- > p->first;) {
+					if(auto& m = st.members[i]; m.destroy) {
+						m.destroy(p->base + m.offset);
+					}
+				}
+			}
+			tlHead = Block{};
+		}
+
+	//---- GroupSlot -----------------------------------------------------------
+
+	template<typename T, typename V, typename G>
+		auto detail::GroupSlot<T,V,G>::GetSlot() noexcept
+			-> typename GroupLayout<G>::Slot
+		{
+			static const auto slot =
+				GroupLayout<G>::template Register<V>(typeid(T).name());
+			return slot;
+		}
+	template<typename T, typename V, typename G>
+		const bool detail::GroupSlot<T,V,G>::kRegistered =
+			(GetSlot(), true);
+
+	//---- DefSaver ------------------------------------------------------------
+
+	template<typename T, typename V>
+		thread_local std::array<
+			V, detail::DefSaver<
+				T,V,std::enable_if_t<(TagTraits<T>::kStackDepth > 0)>
+				>::kDepth
+			>
+			detail::DefSaver<
+				T,V,std::enable_if_t<(TagTraits<T>::kStackDepth > 0)>
+				>::tlStack{};
+	template<typename T, typename V>
+		thread_local std::size_t detail::DefSaver<
+			T,V,std::enable_if_t<(TagTraits<T>::kStackDepth > 0)>
+			>::tlTop = 0;
+	template<typename T, typename V>
+		detail::DefSaver<
+			T,V,std::enable_if_t<(TagTraits<T>::kStackDepth > 0)>
+			>::DefSaver(const V& cur)
+			noexcept(std::is_nothrow_copy_assignable_v<V>)
+		{
+			if(tlTop < kDepth) {
+				tlStack[tlTop] = cur;
+			}
+			else if constexpr(
+				TagTraits<T>::kOnOverflow == kOverflow::Terminate
+				)
+			{
+				std::terminate();
+			}
+			++tlTop;
+		}
+	template<typename T, typename V>
+		void detail::DefSaver<
+			T,V,std::enable_if_t<(TagTraits<T>::kStackDepth > 0)>
+			>::restore(V& cur) noexcept
+		{
+			if(--tlTop < kDepth) {
+				cur = std::move(tlStack[tlTop]);
+			}
+		}
+
 	//---- WithDefArgBase ------------------------------------------------------
 
 	template<typename T, typename V>
 		auto WithDefArgBase<T,V>::tlDefVal() noexcept -> V& {
-			return OptArgBase<OptArg<T,V>,T,V>::tlDefVal;
+			return OptArgBase<OptArg<T,V>,T,V>::DefVal();
+		}
+	template<typename T, typename V>
+		auto WithDefArgBase<T,V>::Detach() -> V& {
+			return OptArgBase<OptArg<T,V>,T,V>::Detach();
 		}
 	template<typename T, typename V>
-		WithDefArgBase<T,V>::WithDefArgBase(const V& v):
-			mSaved{tlDefVal()}
+		WithDefArgBase<T,V>::WithDefArgBase(const V& v) noexcept(kNoThrowCopy):
+			detail::DefSaver<T,V>{Detach()}
 		{
-			tlDefVal() = v;
+			if(this->Pushed()) {
+				tlDefVal() = v;
+			}
+			detail::TraceOp<T>(kRecOp::Enter, tlDefVal());
 		}
 	template<typename T, typename V> template<typename MergeFn>
 		WithDefArgBase<T,V>::WithDefArgBase(
 			const V& v, MergeFn&& mergeFn
 			):
-			mSaved{tlDefVal()}
+			detail::DefSaver<T,V>{Detach()}
 		{
-			mergeFn(tlDefVal(), v);
+			CheckMergeFn<MergeFn>();
+			if(this->Pushed()) {
+				mergeFn(tlDefVal(), v);
+			}
+			detail::TraceOp<T>(kRecOp::Enter, tlDefVal());
 		}
 	template<typename T, typename V> template<typename MergeFn>
 		WithDefArgBase<T,V>::WithDefArgBase(
 			V&& v, MergeFn&& mergeFn
 			) noexcept:
-			mSaved{tlDefVal()}
+			detail::DefSaver<T,V>{Detach()}
 		{
-			mergeFn(tlDefVal(), std::move(v));
+			CheckMergeFn<MergeFn>();
+			if(this->Pushed()) {
+				mergeFn(tlDefVal(), std::move(v));
+			}
+			detail::TraceOp<T>(kRecOp::Enter, tlDefVal());
 		}
 	template<typename T, typename V>
 		WithDefArgBase<T,V>::WithDefArgBase(V&& v) noexcept:
-			mSaved{tlDefVal()}
+			detail::DefSaver<T,V>{Detach()}
 		{
-			tlDefVal() = std::move(v);
+			if(this->Pushed()) {
+				tlDefVal() = std::move(v);
+			}
+			detail::TraceOp<T>(kRecOp::Enter, tlDefVal());
 		}
 	template<typename T, typename V>
 		WithDefArgBase<T,V>::~WithDefArgBase() noexcept {
-			tlDefVal() = std::move(mSaved);
+			this->restore(tlDefVal());
+			detail::TraceOp<T>(kRecOp::Exit, tlDefVal());
 		}
 
 	// ---- WithDefFlags -------------------------------------------------------
 
 	template<typename T, typename I>
 		WithDefFlags<T,I>::WithDefFlags(I mask, kBitwise op) noexcept:
-			WithDefArg<T,I>{mask, kHandleOp[op]}
+			WithDefArg<T,I>{mask, kHandleOp[static_cast<std::size_t>(op)]}
+		{
+		}
+
+	//---- NotifyChange --------------------------------------------------------
+
+	template<typename T, typename V>
+		void detail::NotifyChange(const V& v) noexcept {
+			if constexpr(TagTraits<T>::kNotify) {
+				if(TagChanges<T>::sCount.load(std::memory_order_relaxed) == 0) {
+					return;
+				}
+				ChangeEvent* event = nullptr;
+				try {
+					event = new typename TagChanges<T>::Event{v};
+				}
+				catch(...) {
+					return;
+				}
+				auto& pending = PendingChanges();
+				event->next = pending.load(std::memory_order_relaxed);
+				while(!pending.compare_exchange_weak(
+					event->next, event,
+					std::memory_order_release, std::memory_order_relaxed
+					)) {}
+			}
+		}
+
+	//---- TagChanges ----------------------------------------------------------
+
+	template<typename T>
+		auto detail::TagChanges<T>::GetState() -> State& {
+			static State state;
+			return state;
+		}
+	template<typename T>
+		void detail::TagChanges<T>::Add(std::shared_ptr<Entry> entry) {
+			auto& st = GetState();
+			std::lock_guard<std::recursive_mutex> lock{st.mutex};
+			st.entries.push_back(std::move(entry));
+			sCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	template<typename T>
+		void detail::TagChanges<T>::Cancel(void* entry) {
+			auto& st = GetState();
+			std::lock_guard<std::recursive_mutex> lock{st.mutex};
+			for(auto it = st.entries.begin(); it != st.entries.end(); ++it) {
+				if(it->get() == entry) {
+					(*it)->active = false;
+					st.entries.erase(it);
+					sCount.fetch_sub(1, std::memory_order_relaxed);
+					break;
+				}
+			}
+		}
+	template<typename T>
+		void detail::TagChanges<T>::Event::deliver() {
+			auto& st = GetState();
+			std::lock_guard<std::recursive_mutex> lock{st.mutex};
+			auto entries = st.entries;
+			for(auto& entry: entries) {
+				auto wanted = !entry->thread || *entry->thread == thread;
+				if(entry->active && wanted) {
+					entry->fn(value, thread);
+				}
+			}
+		}
+
+	//---- Subscription --------------------------------------------------------
+
+	inline Subscription::Subscription(
+		void(*cancel)(void*), std::shared_ptr<void> entry
+		) noexcept:
+		mCancel{cancel}, mEntry{std::move(entry)}
 		{
 		}
+	inline Subscription::Subscription(Subscription&& s) noexcept:
+		mCancel{s.mCancel}, mEntry{std::move(s.mEntry)}
+		{
+			s.mCancel = nullptr;
+		}
+	inline Subscription::~Subscription() {
+			reset();
+		}
+	inline auto Subscription::operator= (Subscription&& s) noexcept
+		-> Subscription&
+		{
+			if(this != &s) {
+				reset();
+				mCancel = s.mCancel;
+				mEntry = std::move(s.mEntry);
+				s.mCancel = nullptr;
+			}
+			return *this;
+		}
+	inline void Subscription::reset() {
+			if(mCancel) {
+				// Keep the entry alive in case this runs from its own callback.
+				auto entry = std::move(mEntry);
+				mCancel(entry.get());
+				mCancel = nullptr;
+			}
+		}
+
+	//---- Subscribe -----------------------------------------------------------
+
+	template<typename T, typename Fn>
+		auto Subscribe(Fn&& fn, std::optional<std::thread::id> thread)
+			-> Subscription
+		{
+			static_assert(
+				TagTraits<T>::kNotify,
+				"Subscribe needs a tag declaring notify = true"
+				);
+			using TChanges = detail::TagChanges<T>;
+			auto entry = std::make_shared<typename TChanges::Entry>();
+			entry->fn = std::forward<Fn>(fn);
+			entry->thread = thread;
+			TChanges::Add(entry);
+			return Subscription{&TChanges::Cancel, std::move(entry)};
+		}
+
+	//---- DeliverChanges ------------------------------------------------------
+
+	inline auto DeliverChanges() -> std::size_t {
+			using TEvent = std::unique_ptr<detail::ChangeEvent>;
+			auto p = detail::PendingChanges().exchange(
+				nullptr, std::memory_order_acquire
+				);
+
+			// The stack runs newest to oldest, so keeping the first event seen
+			// for each tag and thread is what coalesces the changes.
+			std::vector<TEvent> keep;
+			while(p) {
+				TEvent event{p};
+				p = p->next;
+				auto seen = false;
+				for(auto& k: keep) {
+					if(k->key == event->key && k->thread == event->thread) {
+						seen = true;
+						break;
+					}
+				}
+				if(!seen) {
+					keep.push_back(std::move(event));
+				}
+			}
+			for(auto it = keep.rbegin(); it != keep.rend(); ++it) {
+				(*it)->deliver();
+			}
+			return keep.size();
+		}
+
+	//---- Tag registry --------------------------------------------------------
+
+	inline auto detail::TagRegistry()
+		-> std::pair<std::mutex&, std::vector<const TagInfo*>&>
+		{
+			static std::mutex mutex;
+			static std::vector<const TagInfo*> tags;
+			return {mutex, tags};
+		}
+	inline auto RegisteredTags() -> std::vector<const TagInfo*> {
+			std::vector<const TagInfo*> tags;
+			std::unordered_set<std::type_index> seen;
+			auto add = [&](const TagInfo* info) {
+				if(seen.insert(*info->type).second) {
+					tags.push_back(info);
+				}
+			};
+		#if OPTARG_SECTION_REGISTRY
+			if(detail::__start_optarg_tags) {
+				auto p = detail::__start_optarg_tags;
+				for(; p != detail::__stop_optarg_tags; ++p) {
+					add(*p);
+				}
+			}
+		#endif
+			auto [mutex, dynamic] = detail::TagRegistry();
+			std::lock_guard<std::mutex> lock{mutex};
+			for(auto info: dynamic) {
+				add(info);
+			}
+			return tags;
+		}
+	template<typename T>
+		constexpr auto detail::MakeTagInfo(const char* name) -> TagInfo {
+			using TOptArg = OptArg<T>;
+			using TValue = typename TOptArg::TValue;
+			TagInfo ti{};
+			ti.type = &typeid(T);
+			ti.name = detail::TagName<T>::Get(name);
+			ti.size = sizeof(TValue);
+			ti.align = alignof(TValue);
+			ti.processRoot = TagTraits<T>::kProcessRoot;
+			ti.format = [](bool root) -> std::optional<std::string> {
+				if constexpr(detail::CanWrite<TValue>::value) {
+					std::ostringstream oss;
+					oss << (root ?
+						TOptArg::GetRootDefault() : TOptArg::GetDefault());
+					return oss.str();
+				}
+				else {
+					return std::nullopt;
+				}
+			};
+			ti.parse = [](std::string_view text) -> bool {
+				if constexpr(!TagTraits<T>::kProcessRoot) {
+					return false;
+				}
+				else if constexpr(std::is_same_v<TValue, std::string>) {
+					TOptArg::SetRootDefault(std::string{text});
+					return true;
+				}
+				else if constexpr(detail::CanRead<TValue>::value) {
+					std::istringstream iss{std::string{text}};
+					TValue v{};
+					if(!(iss >> v) || !(iss >> std::ws).eof()) {
+						return false;
+					}
+					TOptArg::SetRootDefault(std::move(v));
+					return true;
+				}
+				else {
+					return false;
+				}
+			};
+			ti.rootWrites = []() noexcept -> std::uint64_t {
+				if constexpr(TagTraits<T>::kProcessRoot) {
+					return detail::ProcessRoot<T, typename T::type>::sWrites
+						.load(std::memory_order_relaxed);
+				}
+				else {
+					return 0;
+				}
+			};
+			ti.subscribers = []() noexcept -> std::size_t {
+				if constexpr(TagTraits<T>::kNotify) {
+					return detail::TagChanges<T>::sCount.load(
+						std::memory_order_relaxed
+						);
+				}
+				else {
+					return 0;
+				}
+			};
+			ti.overridden = &TOptArg::IsOverridden;
+			ti.revert = &TOptArg::RevertDefault;
+			using TStored = typename T::type;
+			using TGroup = typename TagTraits<T>::TGroup;
+			ti.storage = TagTraits<T>::kStoreIn;
+			if constexpr(
+				detail::TagField<T>::value || !std::is_void_v<TGroup>
+				)
+			{
+				ti.tlsBytes = 0;
+			}
+			else if constexpr(TagTraits<T>::kStoreIn == kStorage::Arena) {
+				ti.tlsBytes = sizeof(TStored*);
+			}
+			else {
+				ti.tlsBytes = sizeof(TStored);
+			}
+			ti.heapBytes = []() -> std::optional<std::size_t> {
+				if constexpr(!detail::CanMeasure<TValue>::value) {
+					return std::nullopt;
+				}
+				else {
+					if(!detail::Touched<T>()) {
+						return 0;
+					}
+					auto& v = TOptArg::GetDefault();
+					auto p = static_cast<const void*>(v.data());
+					auto self = static_cast<const void*>(&v);
+					auto end = static_cast<const void*>(&v + 1);
+					if(
+						std::less_equal<const void*>{}(self, p) &&
+						std::less<const void*>{}(p, end)
+						)
+					{
+						return 0;
+					}
+					return v.capacity() *
+						sizeof(typename TValue::value_type);
+				}
+			};
+			return ti;
+		}
+	template<typename T>
+		auto RegisterTag(const char* name) -> const TagInfo& {
+			static const TagInfo info = detail::MakeTagInfo<T>(name);
+
+			auto [mutex, tags] = detail::TagRegistry();
+			std::lock_guard<std::mutex> lock{mutex};
+			for(auto p: tags) {
+				if(p == &info) {
+					return info;
+				}
+			}
+			tags.push_back(&info);
+			return info;
+		}
+
+	//---- GetThreadFootprint --------------------------------------------------
+
+	inline auto GetThreadFootprint() -> ThreadFootprint {
+			ThreadFootprint fp{};
+			for(auto ti: RegisteredTags()) {
+				fp.tls += ti->tlsBytes;
+				if(auto heap = ti->heapBytes()) {
+					fp.heap += *heap;
+				}
+			}
+			fp.arena = detail::DefArena::ThisThread().reserved();
+			return fp;
+		}
+
+	//---- Probe ---------------------------------------------------------------
+
+	template<typename T, typename V>
+		void detail::Probe(
+			[[maybe_unused]] kRecOp op, [[maybe_unused]] const V& v) noexcept
+		{
+		#if OPTARG_USDT
+			const char* name = TagName<T>::Get(typeid(T).name());
+			std::uint64_t bits = 0;
+			if constexpr(std::is_trivially_copyable_v<V>) {
+				std::memcpy(&bits, &v, std::min(sizeof v, sizeof bits));
+			}
+			std::uint32_t size = sizeof v;
+			switch(op) {
+			case kRecOp::Set:
+				DTRACE_PROBE3(optarg, set_default, name, bits, size);
+				break;
+			case kRecOp::SetRoot:
+				DTRACE_PROBE3(optarg, set_root_default, name, bits, size);
+				break;
+			case kRecOp::Enter:
+				DTRACE_PROBE3(optarg, scope_enter, name, bits, size);
+				break;
+			case kRecOp::Exit:
+				DTRACE_PROBE3(optarg, scope_exit, name, bits, size);
+				break;
+			}
+		#endif
+		}
+
+	//---- ResetGroup ----------------------------------------------------------
+
+	template<typename Group>
+		void ResetGroup() noexcept {
+			detail::GroupEpoch<Group>::sGen.fetch_add(
+				1, std::memory_order_release
+				);
+		}
+
+	//---- ArgValue ------------------------------------------------------------
+
+	template<typename Tag, typename Arg>
+		constexpr auto ArgValue(Arg&& arg) noexcept(
+			!detail::IsOptArg<std::decay_t<Arg>>::value ||
+			std::is_lvalue_reference_v<Arg>
+			) -> decltype(auto)
+		{
+			using A = std::decay_t<Arg>;
+			if constexpr(detail::IsUseDefault<A>::value) {
+				static_assert(
+					std::is_same_v<typename A::TTag, Tag>,
+					"UseDefault of a different tag"
+					);
+				return OptArg<Tag>::GetDefault();
+			}
+			else if constexpr(detail::IsOptArg<A>::value) {
+				static_assert(
+					std::is_same_v<typename A::TTag, Tag>,
+					"OptArg of a different tag"
+					);
+				return std::forward<Arg>(arg).value();
+			}
+			else {
+				return std::forward<Arg>(arg);
+			}
+		}
+
+	//---- GetConfig/SetConfig -------------------------------------------------
+
+	template<typename Config>
+		auto GetConfig() noexcept -> const Config& {
+			return OptArg<ConfigOf<Config>>::GetDefault();
+		}
+	template<typename Config>
+		void SetConfig(const Config& config) {
+			OptArg<ConfigOf<Config>>::SetDefault(config);
+		}
+
+	//---- WarmThread ----------------------------------------------------------
+
+	inline auto detail::Prewarm::TheState() -> State& {
+			static State state;
+			return state;
+		}
+	inline auto detail::Prewarm::Add(TWarmFn fn) -> bool {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.fns.push_back(fn);
+			return true;
+		}
+	inline auto detail::Prewarm::List() -> std::vector<TWarmFn> {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			return st.fns;
+		}
+	inline void WarmThread() {
+			for(auto fn: detail::Prewarm::List()) {
+				fn();
+			}
+		}
+
+	//---- WarmDefaults --------------------------------------------------------
+
+	template<typename... Tags>
+		void WarmDefaults() noexcept {
+			// A volatile read keeps the compiler from discarding the access.
+			(static_cast<void>(
+				*static_cast<const volatile unsigned char*>(
+					static_cast<const void*>(&OptArg<Tags>::GetDefault())
+					)
+				), ...);
+		}
 }
 
+#if OPTARG_RECORD
+	#include "optarg_record.hpp"
+#endif
+#if OPTARG_LAYOUT_PROFILE
+	#include "optarg_layout.hpp"
+#endif
+
 #endif
@@ -0,0 +1,337 @@
+#ifndef OPTARG_ADMIN_HPP
+#define OPTARG_ADMIN_HPP
+
+/**
+optarg_admin
+
+This optional companion to optarg.hpp lets you inspect and change the defaults
+of a running process from a shell. It serves a simple line-based text protocol
+on a UNIX-domain socket, so any tool that can talk to one will do:
+
+	$ socat - UNIX-CONNECT:/run/myapp/optarg.sock
+	list
+	max_conns size=4 root=yes
+	verbose size=1 root=no
+
+	set max_conns 64
+	ok
+
+	get max_conns
+	ok 64
+
+Only tags registered with OPTARG_REGISTER are visible (see "Tag registry" in
+optarg.hpp), and only those declaring process_root can be set.
+
+Commands:
+	list:
+		Lists every registered tag with the size of its value type and whether
+		its root default can be set.
+	get <tag>:
+		Shows the root default of the tag. For a tag without process_root, this
+		is the default each thread starts out with.
+	set <tag> <value>:
+		Parses the value and publishes it as the tag's new root default.
+		Threads that have not overridden the default pick it up on their next
+		read.
+	stats:
+		Lists per-tag counters: how many times the root has been published
+		and how many change subscriptions the tag has.
+	help:
+		Lists the commands.
+
+Each response ends with an empty line. Errors come back as a single line that
+starts with "error".
+
+The server runs entirely on a thread of its own. Setting a root default goes
+through OptArg::SetRootDefault, which publishes the new value with an atomic
+pointer swap, so threads reading their defaults never wait on the server.
+This header is POSIX-only.
+**/
+
+#include "optarg.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace oarg {
+
+	/**
+	AdminServer
+
+	Constructing an AdminServer binds the socket at the path you give it
+	(replacing any stale socket file at that path) and starts serving on a
+	background thread. Destroying it, or calling stop(), shuts the thread down
+	and removes the socket file. Any failure to set up the socket gets thrown
+	as a std::system_error.
+
+		oarg::AdminServer admin{"/run/myapp/optarg.sock"};
+
+	Access to the socket is governed by the file system permissions of its
+	path, so put it somewhere only trusted users can reach.
+	**/
+	class AdminServer {
+	public:
+		explicit AdminServer(std::string path);
+		AdminServer(const AdminServer&) = delete;
+		~AdminServer();
+
+		void stop() noexcept;
+
+		/**
+		Handle class method
+
+		This processes a single command line and returns the response,
+		exactly as the socket would. It is public mainly to help you test your
+		tag registrations without a socket.
+		**/
+		static auto Handle(std::string_view line) -> std::string;
+
+	private:
+		struct Client {
+			int fd;
+			std::string input;
+		};
+
+		void run();
+		static auto Find(std::string_view name) -> const TagInfo*;
+		static void Send(int fd, const std::string& text) noexcept;
+		[[noreturn]] static void Fail(const char* what);
+
+		std::string mPath;
+		int mListen = -1;
+		int mWake[2] = {-1, -1};
+		std::thread mThread;
+	};
+
+	//==== Implementation ======================================================
+
+	inline AdminServer::AdminServer(std::string path):
+		mPath{std::move(path)}
+		{
+			sockaddr_un addr{};
+			addr.sun_family = AF_UNIX;
+			if(mPath.size() >= sizeof addr.sun_path) {
+				throw std::system_error{
+					std::make_error_code(std::errc::filename_too_long),
+					"optarg admin socket path"
+					};
+			}
+			std::memcpy(addr.sun_path, mPath.c_str(), mPath.size() + 1);
+
+			mListen = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if(mListen < 0) {
+				Fail("optarg admin socket");
+			}
+			::unlink(mPath.c_str());
+			if(::bind(
+					mListen, reinterpret_cast<sockaddr*>(&addr), sizeof addr
+					) < 0 ||
+				::listen(mListen, 4) < 0 ||
+				::pipe2(mWake, O_CLOEXEC) < 0)
+			{
+				auto err = errno;
+				stop();
+				errno = err;
+				Fail("optarg admin socket");
+			}
+			mThread = std::thread{&AdminServer::run, this};
+		}
+	inline AdminServer::~AdminServer() {
+			stop();
+		}
+	inline void AdminServer::stop() noexcept {
+			if(mThread.joinable()) {
+				char c = 0;
+				while(::write(mWake[1], &c, 1) < 0 && errno == EINTR) {}
+				mThread.join();
+			}
+			for(auto fd: {mListen, mWake[0], mWake[1]}) {
+				if(fd >= 0) {
+					::close(fd);
+				}
+			}
+			if(mListen >= 0) {
+				::unlink(mPath.c_str());
+			}
+			mListen = mWake[0] = mWake[1] = -1;
+		}
+	inline void AdminServer::Fail(const char* what) {
+			throw std::system_error{errno, std::generic_category(), what};
+		}
+	inline void AdminServer::Send(int fd, const std::string& text) noexcept {
+			for(std::size_t i = 0; i < text.size();) {
+				auto n = ::send(
+					fd, text.data() + i, text.size() - i, MSG_NOSIGNAL
+					);
+				if(n < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					return;
+				}
+				i += static_cast<std::size_t>(n);
+			}
+		}
+	inline void AdminServer::run() {
+			std::vector<Client> clients;
+			std::vector<pollfd> fds;
+			for(;;) {
+				fds.clear();
+				fds.push_back(pollfd{mWake[0], POLLIN, 0});
+				fds.push_back(pollfd{mListen, POLLIN, 0});
+				for(auto& c: clients) {
+					fds.push_back(pollfd{c.fd, POLLIN, 0});
+				}
+				if(::poll(fds.data(), fds.size(), -1) < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					break;
+				}
+				if(fds[0].revents) {
+					break;
+				}
+				if(fds[1].revents & POLLIN) {
+					auto fd = ::accept4(
+						mListen, nullptr, nullptr, SOCK_CLOEXEC
+						);
+					if(fd >= 0) {
+						clients.push_back(Client{fd, {}});
+					}
+				}
+				for(std::size_t i = 2; i < fds.size(); ++i) {
+					if(!fds[i].revents) {
+						continue;
+					}
+					auto& c = clients[i - 2];
+					char buf[512];
+					auto n = ::read(c.fd, buf, sizeof buf);
+					if(n <= 0) {
+						if(n < 0 && errno == EINTR) {
+							continue;
+						}
+						::close(c.fd);
+						c.fd = -1;
+						continue;
+					}
+					c.input.append(buf, static_cast<std::size_t>(n));
+					for(std::size_t eol; (eol = c.input.find('\n')) !=
+						std::string::npos;)
+					{
+						auto line = c.input.substr(0, eol);
+						c.input.erase(0, eol + 1);
+						std::string response;
+						try {
+							response = Handle(line);
+						}
+						catch(const std::exception& e) {
+							response = "error " + std::string{e.what()} + "\n\n";
+						}
+						Send(c.fd, response);
+					}
+					if(c.input.size() > 65536) {
+						::close(c.fd);
+						c.fd = -1;
+					}
+				}
+				for(auto it = clients.begin(); it != clients.end();) {
+					it = it->fd < 0 ? clients.erase(it) : it + 1;
+				}
+			}
+			for(auto& c: clients) {
+				::close(c.fd);
+			}
+		}
+	inline auto AdminServer::Find(std::string_view name) -> const TagInfo* {
+			for(auto p: RegisteredTags()) {
+				if(name == p->name) {
+					return p;
+				}
+			}
+			return nullptr;
+		}
+	inline auto AdminServer::Handle(std::string_view line) -> std::string {
+			auto next = [&line]() -> std::string_view {
+				auto i = line.find_first_not_of(" \t\r");
+				line.remove_prefix(i == line.npos ? line.size() : i);
+				auto j = line.find_first_of(" \t\r");
+				auto word = line.substr(0, j);
+				line.remove_prefix(word.size());
+				return word;
+			};
+			auto rest = [&line]() -> std::string_view {
+				auto i = line.find_first_not_of(" \t");
+				line.remove_prefix(i == line.npos ? line.size() : i);
+				while(!line.empty() &&
+					(line.back() == '\r' || line.back() == ' '))
+				{
+					line.remove_suffix(1);
+				}
+				return line;
+			};
+
+			std::string out;
+			auto cmd = next();
+			if(cmd == "list") {
+				for(auto p: RegisteredTags()) {
+					out += p->name;
+					out += " size=" + std::to_string(p->size);
+					out += p->processRoot ? " root=yes\n" : " root=no\n";
+				}
+			}
+			else if(cmd == "stats") {
+				for(auto p: RegisteredTags()) {
+					out += p->name;
+					out += " root_writes=" + std::to_string(p->rootWrites());
+					out += " subscribers=" + std::to_string(p->subscribers());
+					out += '\n';
+				}
+			}
+			else if(cmd == "get" || cmd == "set") {
+				auto name = next();
+				auto info = Find(name);
+				if(!info) {
+					return "error unknown tag: " + std::string{name} + "\n\n";
+				}
+				if(cmd == "get") {
+					auto text = info->format(true);
+					if(!text) {
+						return "error value cannot be formatted\n\n";
+					}
+					out = "ok " + *text + '\n';
+				}
+				else if(!info->processRoot) {
+					return "error tag has no process root\n\n";
+				}
+				else if(!info->parse(rest())) {
+					return "error value does not parse\n\n";
+				}
+				else {
+					out = "ok\n";
+				}
+			}
+			else if(cmd == "help" || cmd.empty()) {
+				out =
+					"list\n"
+					"get <tag>\n"
+					"set <tag> <value>\n"
+					"stats\n";
+			}
+			else {
+				return "error unknown command: " + std::string{cmd} + "\n\n";
+			}
+			return out + '\n';
+		}
+}
+
+#endif
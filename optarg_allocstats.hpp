@@ -0,0 +1,301 @@
+#ifndef OPTARG_ALLOCSTATS_HPP
+#define OPTARG_ALLOCSTATS_HPP
+
+/**
+optarg_allocstats
+
+This companion to optarg.hpp tells you how many heap allocations (and how many
+bytes) happen while particular WithDefArg scopes are active, which is a handy
+way to find out which modes or request classes are allocation-heavy. You opt a
+tag in with the alloc_stats setting (see TagTraits):
+
+	struct req_class {
+		using type = RequestClass;
+		static constexpr bool alloc_stats = true;
+	};
+
+Every allocation a thread makes goes to the innermost alloc_stats scope active
+on that thread, if any. The counts are per thread and need no locking to
+update. GetAllocStats adds them up across all threads (including ones that
+have since exited):
+
+	auto stats = oarg::GetAllocStats<req_class>();
+	std::cout << stats.count << " allocations, " << stats.bytes << " bytes\n";
+
+Note that the counts are per tag, not per value. If you want a breakdown by
+request class, give each class its own tag.
+
+The counting itself is done by replacements for the global operator new, which
+this header only defines if OPTARG_ALLOCSTATS_IMPL is defined before including
+it. Do that in exactly one source file of your program:
+
+	#define OPTARG_ALLOCSTATS_IMPL
+	#include "optarg_allocstats.hpp"
+
+The replacements allocate with malloc (or aligned_alloc for over-aligned
+types), so they would also replace any other allocator you link in through
+operator new. Without them, alloc_stats scopes still work but count nothing.
+**/
+
+#include "optarg.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace oarg {
+
+	struct AllocStats {
+		std::uint64_t count = 0;
+		std::uint64_t bytes = 0;
+	};
+
+	/**
+	GetAllocStats function template
+
+	Returns: the allocations made so far within alloc_stats scopes of Tag,
+		summed across all threads
+
+	The counts of threads still running are read while they may be updating
+	them, so the total is a snapshot that can be slightly behind.
+	**/
+	template<typename Tag>
+		auto GetAllocStats() -> AllocStats;
+
+	namespace detail {
+
+		/*
+		AllocCounts only ever gets written by the thread it belongs to, so
+		relaxed loads and stores suffice. They are atomic only so that
+		GetAllocStats may read them from another thread.
+		*/
+		struct AllocCounts {
+			std::atomic<std::uint64_t> count{0};
+			std::atomic<std::uint64_t> bytes{0};
+
+			void add(std::size_t n) noexcept {
+				count.store(
+					count.load(std::memory_order_relaxed) + 1,
+					std::memory_order_relaxed
+					);
+				bytes.store(
+					bytes.load(std::memory_order_relaxed) + n,
+					std::memory_order_relaxed
+					);
+			 }
+		};
+
+		inline void CountAlloc(std::size_t n) noexcept {
+			if(auto counts = AllocScope::tlCurrent) {
+				counts->add(n);
+			}
+		}
+
+		/*
+		AllocTally keeps the per-thread counts of a tag in an intrusive list
+		so that Total can find them. A thread's node joins the list the
+		first time the thread enters a scope of the tag, and folds its counts
+		into the retired totals when the thread exits.
+		*/
+		template<typename Tag>
+			class AllocTally {
+			public:
+				static auto This() noexcept -> AllocCounts& {
+					thread_local Node node;
+					return node.counts;
+				 }
+				static auto Total() -> AllocStats;
+
+			private:
+				struct Node {
+					Node() noexcept;
+					~Node();
+
+					AllocCounts counts;
+					Node* prev = nullptr;
+					Node* next = nullptr;
+				};
+				struct State {
+					std::mutex mutex;
+					Node* head = nullptr;
+					AllocStats retired;
+				};
+
+				static auto TheState() noexcept -> State& {
+					static State state;
+					return state;
+				 }
+			};
+	}
+
+	//==== Template Implementation =============================================
+
+	//---- AllocTally ----------------------------------------------------------
+
+	template<typename Tag>
+		detail::AllocTally<Tag>::Node::Node() noexcept {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			next = st.head;
+			if(next) {
+				next->prev = this;
+			}
+			st.head = this;
+		}
+	template<typename Tag>
+		detail::AllocTally<Tag>::Node::~Node() {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.retired.count += counts.count.load(std::memory_order_relaxed);
+			st.retired.bytes += counts.bytes.load(std::memory_order_relaxed);
+			(prev ? prev->next : st.head) = next;
+			if(next) {
+				next->prev = prev;
+			}
+		}
+	template<typename Tag>
+		auto detail::AllocTally<Tag>::Total() -> AllocStats {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			auto total = st.retired;
+			for(auto p = st.head; p; p = p->next) {
+				total.count += p->counts.count.load(std::memory_order_relaxed);
+				total.bytes += p->counts.bytes.load(std::memory_order_relaxed);
+			}
+			return total;
+		}
+
+	//---- ThreadAllocCounts ---------------------------------------------------
+
+	template<typename Tag>
+		auto detail::ThreadAllocCounts() noexcept -> AllocCounts& {
+			return AllocTally<Tag>::This();
+		}
+
+	//---- GetAllocStats -------------------------------------------------------
+
+	template<typename Tag>
+		auto GetAllocStats() -> AllocStats {
+			static_assert(
+				TagTraits<Tag>::kAllocStats, "tag does not declare alloc_stats"
+				);
+			return detail::AllocTally<Tag>::Total();
+		}
+}
+
+#endif
+
+/*
+The operator new replacements sit outside the main include guard so that they
+get defined even if this header was already included without
+OPTARG_ALLOCSTATS_IMPL earlier in the same file.
+*/
+#if defined(OPTARG_ALLOCSTATS_IMPL) && !defined(OPTARG_ALLOCSTATS_IMPL_DONE)
+#define OPTARG_ALLOCSTATS_IMPL_DONE
+
+	namespace oarg::detail {
+		inline auto HookedAlloc(std::size_t n, std::size_t align) -> void* {
+			auto size = n ? n : 1;
+			for(;;) {
+				void* p = align <= alignof(std::max_align_t) ?
+					std::malloc(size) :
+					std::aligned_alloc(
+						align, (size + align - 1) / align * align
+						);
+				if(p) {
+					CountAlloc(n);
+					return p;
+				}
+				auto handler = std::get_new_handler();
+				if(!handler) {
+					throw std::bad_alloc{};
+				}
+				handler();
+			}
+		}
+		inline auto HookedAllocNoThrow(std::size_t n, std::size_t align)
+			noexcept -> void*
+		{
+			try {
+				return HookedAlloc(n, align);
+			}
+			catch(...) {
+				return nullptr;
+			}
+		}
+	}
+
+	auto operator new(std::size_t n) -> void* {
+		return oarg::detail::HookedAlloc(n, 0);
+	}
+	auto operator new[](std::size_t n) -> void* {
+		return oarg::detail::HookedAlloc(n, 0);
+	}
+	auto operator new(std::size_t n, std::align_val_t a) -> void* {
+		return oarg::detail::HookedAlloc(n, static_cast<std::size_t>(a));
+	}
+	auto operator new[](std::size_t n, std::align_val_t a) -> void* {
+		return oarg::detail::HookedAlloc(n, static_cast<std::size_t>(a));
+	}
+	auto operator new(std::size_t n, const std::nothrow_t&) noexcept
+		-> void*
+	{
+		return oarg::detail::HookedAllocNoThrow(n, 0);
+	}
+	auto operator new[](std::size_t n, const std::nothrow_t&) noexcept
+		-> void*
+	{
+		return oarg::detail::HookedAllocNoThrow(n, 0);
+	}
+	auto operator new(
+		std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+		-> void*
+	{
+		return oarg::detail::HookedAllocNoThrow(
+			n, static_cast<std::size_t>(a)
+			);
+	}
+	auto operator new[](
+		std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept
+		-> void*
+	{
+		return oarg::detail::HookedAllocNoThrow(
+			n, static_cast<std::size_t>(a)
+			);
+	}
+
+	void operator delete(void* p) noexcept { std::free(p); }
+	void operator delete[](void* p) noexcept { std::free(p); }
+	void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+	void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+	void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+	void operator delete[](void* p, std::align_val_t) noexcept {
+		std::free(p);
+	}
+	void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+		std::free(p);
+	}
+	void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+		std::free(p);
+	}
+	void operator delete(void* p, const std::nothrow_t&) noexcept {
+		std::free(p);
+	}
+	void operator delete[](void* p, const std::nothrow_t&) noexcept {
+		std::free(p);
+	}
+	void operator delete(
+		void* p, std::align_val_t, const std::nothrow_t&) noexcept
+	{
+		std::free(p);
+	}
+	void operator delete[](
+		void* p, std::align_val_t, const std::nothrow_t&) noexcept
+	{
+		std::free(p);
+	}
+
+#endif
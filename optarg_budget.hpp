@@ -0,0 +1,188 @@
+#ifndef OPTARG_BUDGET_HPP
+#define OPTARG_BUDGET_HPP
+
+/**
+optarg_budget
+
+This companion to optarg.hpp provides consumable budgets: retry limits, byte
+quotas, and such, which a request installs once and which the code it calls
+draws down without anyone having to pass the budget around explicitly.
+
+	struct RetryBudget { using type = oarg::Budget*; };
+
+	void HandleRequest() {
+		oarg::WithBudget<RetryBudget> retries{3};
+		Fetch(); // may be several calls deep
+	}
+	void Fetch() {
+		while(!TryFetch()) {
+			if(!oarg::TryConsume<RetryBudget>()) {
+				throw TooManyRetries{};
+			}
+		}
+	}
+
+A budget tag's value type is a Budget pointer. A thread with no budget
+installed sees nullptr, which the free functions below treat as unlimited.
+
+A budget starts out owned by the thread that installed it, and while that is
+the case, consuming from it is a plain load, compare, and store. If tasks on
+other threads need to draw from the same budget, call ShareBudget on the
+installing thread and hand the pointer it returns to the tasks, which install
+it with a WithDefArg of their own:
+
+	auto budget = oarg::ShareBudget<RetryBudget>();
+	pool.submit([budget] {
+		oarg::WithDefArg<RetryBudget> inherit{budget};
+		Fetch();
+	});
+
+From then on, every consumption goes through an atomic compare-and-swap.
+It is up to you to make sure the tasks finish before the WithBudget that owns
+the budget goes out of scope.
+**/
+
+#include "optarg.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace oarg {
+
+	/**
+	Budget
+
+	Methods:
+		tryConsume:
+			Takes n units from the budget if at least that many remain.
+			Returns: whether it did
+		consume:
+			Takes n units from the budget unconditionally, which can leave it
+			negative. This suits quotas where the units have already been
+			spent by the time you find out how many there were.
+		refund:
+			Gives n units back.
+		remaining:
+			Returns: the units left (possibly negative; see consume)
+		share:
+			Switches the budget over to atomic operations so that other
+			threads may use it. This must be called by the thread that owns
+			the budget, before any other thread gets hold of it.
+		shared:
+			Returns: whether share() has been called
+	**/
+	class Budget {
+	public:
+		explicit Budget(std::int64_t units) noexcept: mLeft{units} {}
+		Budget(const Budget&) = delete;
+
+		auto tryConsume(std::int64_t n = 1) noexcept -> bool;
+		void consume(std::int64_t n) noexcept;
+		void refund(std::int64_t n) noexcept { consume(-n); }
+		auto remaining() const noexcept -> std::int64_t {
+			return mLeft.load(std::memory_order_relaxed);
+		 }
+
+		void share() noexcept { mShared = true; }
+		auto shared() const noexcept -> bool { return mShared; }
+
+	private:
+		/*
+		Until the budget is shared, only the owning thread ever touches
+		mLeft, so relaxed loads and stores (which compile to plain moves) are
+		all it needs. mShared itself is only written before the hand-off to
+		other threads, which has to synchronize anyway.
+		*/
+		std::atomic<std::int64_t> mLeft;
+		bool mShared = false;
+	};
+
+	/**
+	WithBudget class template
+
+	Creates a budget of the given size and installs it as the default for
+	Tag until the WithBudget goes out of scope. Like WithDefArg, it is meant
+	to be a local variable. A nested WithBudget for the same tag temporarily
+	replaces the outer budget rather than drawing from it.
+	**/
+	template<typename Tag>
+		class WithBudget: public Budget {
+		public:
+			explicit WithBudget(std::int64_t units) noexcept:
+				Budget{units}, mScope{this} {}
+
+		private:
+			WithDefArg<Tag> mScope;
+		};
+
+	/**
+	TryConsume/Consume/Remaining function templates
+
+	These apply the Budget methods of the same names to the calling thread's
+	budget for Tag. With no budget installed, TryConsume always succeeds,
+	Consume does nothing, and Remaining returns INT64_MAX.
+
+	ShareBudget function template
+
+	Shares the calling thread's budget for Tag (see Budget::share) and returns
+	it, so that you can pass it to tasks on other threads.
+	**/
+	template<typename Tag>
+		auto TryConsume(std::int64_t n = 1) noexcept -> bool {
+			auto budget = OptArg<Tag>::GetDefault();
+			return !budget || budget->tryConsume(n);
+		}
+	template<typename Tag>
+		void Consume(std::int64_t n) noexcept {
+			if(auto budget = OptArg<Tag>::GetDefault()) {
+				budget->consume(n);
+			}
+		}
+	template<typename Tag>
+		auto Remaining() noexcept -> std::int64_t {
+			auto budget = OptArg<Tag>::GetDefault();
+			return budget ? budget->remaining() : INT64_MAX;
+		}
+	template<typename Tag>
+		auto ShareBudget() noexcept -> Budget* {
+			auto budget = OptArg<Tag>::GetDefault();
+			if(budget) {
+				budget->share();
+			}
+			return budget;
+		}
+
+	//==== Implementation ======================================================
+
+	inline auto Budget::tryConsume(std::int64_t n) noexcept -> bool {
+			auto left = mLeft.load(std::memory_order_relaxed);
+			if(!mShared) {
+				if(left < n) {
+					return false;
+				}
+				mLeft.store(left - n, std::memory_order_relaxed);
+				return true;
+			}
+			do {
+				if(left < n) {
+					return false;
+				}
+			} while(!mLeft.compare_exchange_weak(
+				left, left - n, std::memory_order_relaxed
+				));
+			return true;
+		}
+	inline void Budget::consume(std::int64_t n) noexcept {
+			if(!mShared) {
+				mLeft.store(
+					mLeft.load(std::memory_order_relaxed) - n,
+					std::memory_order_relaxed
+					);
+			}
+			else {
+				mLeft.fetch_sub(n, std::memory_order_relaxed);
+			}
+		}
+}
+
+#endif
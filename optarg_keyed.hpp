@@ -0,0 +1,495 @@
+#ifndef OPTARG_KEYED_HPP
+#define OPTARG_KEYED_HPP
+
+/**
+optarg_keyed
+
+This companion to optarg.hpp gives a tag defaults that vary by a key known only
+at run time, such as a timeout per RPC path or a quota per tenant. Any key
+without a default of its own falls back to the tag's usual default, so you keep
+setting that the way you always have:
+
+	struct timeout_ms { using type = int; };
+
+	oarg::OptArg<timeout_ms>::SetDefault(500);
+	oarg::KeyedOptArg<timeout_ms>::SetPrefixDefault("/search/", 2000);
+	oarg::KeyedOptArg<timeout_ms>::SetKeyDefault("/search/suggest", 100);
+
+	void Call(std::string_view path, oarg::KeyedOptArg<timeout_ms> t = {}) {
+		Send(path, t.value(path));
+	}
+
+	Call("/search/suggest");   // 100: exact key
+	Call("/search/images");    // 2000: longest matching prefix
+	Call("/users/get");        // 500: the calling thread's timeout_ms default
+	Call("/users/get", 50);    // 50: passed explicitly
+
+Keyed defaults are process-wide (unlike tag defaults, which are per thread).
+Each change publishes a new immutable table with a single atomic store, so a
+lookup never takes a lock or allocates. It takes one hash probe for the exact
+key, then a binary search over the prefixes. Every table ever published stays
+in memory until the process exits, since readers hold no reference to it. So
+if you have many keys to change, change them all at once through
+SetKeyDefaults rather than one call apiece.
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace oarg {
+
+	/**
+	KeyedDefaults class template
+
+	A mutable set of per-key defaults, to be handed to
+	KeyedOptArg::SetKeyDefaults. An exact key matches only itself, while a
+	prefix matches any key that starts with it (including the prefix itself).
+	An empty prefix therefore matches every key.
+
+	Methods:
+		set/setPrefix:
+			Give a key or prefix the value v, replacing any it had.
+		erase/erasePrefix:
+			Returns: whether there was a value to remove
+		find:
+			Returns: the value a lookup of key would resolve to (the exact
+				key's, else the longest matching prefix's), or nullptr
+		size/empty:
+			Count the exact keys and prefixes together.
+	**/
+	template<typename Value>
+		class KeyedDefaults {
+		public:
+			using TMap = std::map<std::string, Value, std::less<>>;
+
+			void set(std::string key, Value v) {
+				mExact.insert_or_assign(std::move(key), std::move(v));
+			 }
+			void setPrefix(std::string prefix, Value v) {
+				mPrefixes.insert_or_assign(std::move(prefix), std::move(v));
+			 }
+			auto erase(std::string_view key) -> bool;
+			auto erasePrefix(std::string_view prefix) -> bool;
+			auto find(std::string_view key) const noexcept -> const Value*;
+
+			auto size() const noexcept -> std::size_t {
+				return mExact.size() + mPrefixes.size();
+			 }
+			auto empty() const noexcept -> bool { return size() == 0; }
+
+			auto exact() const noexcept -> const TMap& { return mExact; }
+			auto prefixes() const noexcept -> const TMap& { return mPrefixes; }
+
+		private:
+			TMap mExact, mPrefixes;
+		};
+
+	/**
+	KeyedOptArg class template
+
+	Works like OptArg, except that value() takes the key whose default it
+	should fall back on. The key is only looked up if no value was passed.
+
+	Class methods:
+		GetDefault:
+			Returns: the default for key: its own, else that of its longest
+				matching prefix, else OptArg<Tag>::GetDefault()
+		FindKeyDefault:
+			Returns: the key's own or prefix default, or nullptr if it has
+				neither
+		GetKeyDefaults:
+			Returns: a copy of all the keyed defaults currently published
+		SetKeyDefaults:
+			Replaces all the keyed defaults in one go.
+		SetKeyDefault/SetPrefixDefault/ClearKeyDefault/ClearPrefixDefault:
+			Change a single key or prefix. Each of these copies the whole
+			table, so prefer SetKeyDefaults for more than a few changes.
+
+	Lookups may run concurrently with any of these. Changes are serialized
+	with respect to each other, and each becomes visible to all threads at
+	once.
+	**/
+	template<typename Tag>
+		class KeyedOptArg {
+		public:
+			using TTag = Tag;
+			using TValue = typename OptArg<Tag>::TValue;
+			using TDefaults = KeyedDefaults<TValue>;
+
+			constexpr KeyedOptArg() noexcept = default;
+			constexpr KeyedOptArg(std::nullopt_t) noexcept {}
+			constexpr KeyedOptArg(UseDefault<Tag>) noexcept {}
+			KeyedOptArg(const TValue& v): mOptVal{v} {}
+			KeyedOptArg(TValue&& v): mOptVal{std::move(v)} {}
+
+			auto defaults() const noexcept -> bool {
+				return !mOptVal.has_value();
+			 }
+			void reset() noexcept { mOptVal.reset(); }
+			auto value(std::string_view key) const& noexcept
+				-> const TValue&
+			 {
+				return mOptVal ? *mOptVal : GetDefault(key);
+			 }
+
+			static auto GetDefault(std::string_view key) noexcept
+				-> const TValue&;
+			static auto FindKeyDefault(std::string_view key) noexcept
+				-> const TValue*;
+
+			static auto GetKeyDefaults() -> TDefaults;
+			static void SetKeyDefaults(const TDefaults& defaults);
+			static void SetKeyDefault(std::string key, TValue v);
+			static void SetPrefixDefault(std::string prefix, TValue v);
+			static void ClearKeyDefault(std::string_view key);
+			static void ClearPrefixDefault(std::string_view prefix);
+
+		private:
+			template<typename Fn>
+				static void Update(Fn&& fn);
+
+			std::optional<TValue> mOptVal;
+		};
+
+	namespace detail {
+
+		/*
+		KeyTable is the immutable, lookup-ready form of a KeyedDefaults.
+
+		Exact keys go in an open-addressed hash table with at least twice as
+		many slots as keys. A slot holds an index into mExact (plus 1, so
+		that 0 means empty) and the upper half of the key's hash, so that
+		probing past other keys need not touch mExact at all.
+
+		Prefixes are kept sorted, each with the index of the longest other
+		prefix that is a prefix of it (its parent). To find the longest
+		prefix of a key, take the last prefix that sorts no later than the
+		key. Any prefix of the key sorts between the two and must therefore
+		be a prefix of that candidate too, no longer than what the candidate
+		has in common with the key. So the answer is the first prefix along
+		the candidate's parent chain that is that short.
+
+		The binary search compares the first 8 bytes of each string as a
+		big-endian integer (see Head) before resorting to the strings
+		themselves. mHeads keeps these integers in an array of their own,
+		which for a few hundred prefixes fits in the L1 cache.
+		*/
+		template<typename Value>
+			class KeyTable {
+			public:
+				explicit KeyTable(const KeyedDefaults<Value>& defaults);
+
+				auto find(std::string_view key) const noexcept -> const Value*;
+				auto defaults() const -> KeyedDefaults<Value>;
+
+			private:
+				static constexpr auto kNone = ~std::size_t{0};
+
+				struct Exact {
+					std::string key;
+					Value value;
+				};
+				struct Slot {
+					std::uint32_t index, check;
+				};
+				struct Prefix {
+					std::string key;
+					std::size_t parent;
+					Value value;
+				};
+
+				static auto Hash(std::string_view key) noexcept
+					-> std::size_t
+				{
+					return std::hash<std::string_view>{}(key);
+				}
+				static auto Check(std::size_t hash) noexcept
+					-> std::uint32_t
+				{
+					return static_cast<std::uint32_t>(
+						static_cast<std::uint64_t>(hash) >> 32
+						);
+				}
+				static auto Head(std::string_view key) noexcept
+					-> std::uint64_t;
+
+				std::vector<Exact> mExact;
+				std::vector<Slot> mSlots;
+				std::vector<Prefix> mPrefixes;
+				std::vector<std::uint64_t> mHeads;
+			};
+
+		/*
+		KeyedRoot publishes a tag's current KeyTable (null until the first
+		change) and keeps every table it has published alive, the same way
+		ProcessRoot keeps its values.
+		*/
+		template<typename Tag, typename Value>
+			struct KeyedRoot {
+				using TTable = KeyTable<Value>;
+
+				struct Published {
+					std::mutex mutex;
+					std::vector<std::unique_ptr<const TTable>> tables;
+				};
+
+				static auto ThePublished() -> Published& {
+					static Published published;
+					return published;
+				 }
+
+				static inline std::atomic<const TTable*> sTable{nullptr};
+			};
+	}
+
+	//==== Template Implementation =============================================
+
+	//---- KeyedDefaults -------------------------------------------------------
+
+	template<typename V>
+		auto KeyedDefaults<V>::erase(std::string_view key) -> bool {
+			auto it = mExact.find(key);
+			if(it == mExact.end()) {
+				return false;
+			}
+			mExact.erase(it);
+			return true;
+		}
+	template<typename V>
+		auto KeyedDefaults<V>::erasePrefix(std::string_view prefix) -> bool {
+			auto it = mPrefixes.find(prefix);
+			if(it == mPrefixes.end()) {
+				return false;
+			}
+			mPrefixes.erase(it);
+			return true;
+		}
+	template<typename V>
+		auto KeyedDefaults<V>::find(std::string_view key) const noexcept
+			-> const V*
+		{
+			if(auto it = mExact.find(key); it != mExact.end()) {
+				return &it->second;
+			}
+			for(auto n = key.size() + 1; n-- > 0;) {
+				auto it = mPrefixes.find(key.substr(0, n));
+				if(it != mPrefixes.end()) {
+					return &it->second;
+				}
+			}
+			return nullptr;
+		}
+
+	//---- KeyTable ------------------------------------------------------------
+
+	template<typename V>
+		detail::KeyTable<V>::KeyTable(const KeyedDefaults<V>& defaults) {
+			mExact.reserve(defaults.exact().size());
+			for(auto& [key, value]: defaults.exact()) {
+				mExact.push_back(Exact{key, value});
+			}
+			if(!mExact.empty()) {
+				std::size_t n = 2;
+				while(n < mExact.size() * 2) {
+					n *= 2;
+				}
+				mSlots.resize(n);
+				for(std::size_t i = 0; i < mExact.size(); ++i) {
+					auto hash = Hash(mExact[i].key);
+					auto j = hash & (n - 1);
+					while(mSlots[j].index) {
+						j = (j + 1) & (n - 1);
+					}
+					mSlots[j] = Slot{
+						static_cast<std::uint32_t>(i + 1), Check(hash)
+						};
+				}
+			}
+
+			// The map's order visits each prefix right after its parents,
+			// so a stack of the prefixes enclosing the current one suffices.
+			mPrefixes.reserve(defaults.prefixes().size());
+			std::vector<std::size_t> enclosing;
+			for(auto& [key, value]: defaults.prefixes()) {
+				while(!enclosing.empty() &&
+					key.compare(
+						0, mPrefixes[enclosing.back()].key.size(),
+						mPrefixes[enclosing.back()].key
+						) != 0)
+				{
+					enclosing.pop_back();
+				}
+				auto parent = enclosing.empty() ? kNone : enclosing.back();
+				enclosing.push_back(mPrefixes.size());
+				mPrefixes.push_back(Prefix{key, parent, value});
+				mHeads.push_back(Head(key));
+			}
+		}
+	template<typename V>
+		auto detail::KeyTable<V>::Head(std::string_view key) noexcept
+			-> std::uint64_t
+		{
+			unsigned char bytes[8] = {};
+			auto n = std::min<std::size_t>(key.size(), 8);
+			if(n > 0) {
+				std::memcpy(bytes, key.data(), n);
+			}
+			std::uint64_t head = 0;
+			for(auto b: bytes) {
+				head = head << 8 | b;
+			}
+			return head;
+		}
+	template<typename V>
+		auto detail::KeyTable<V>::find(std::string_view key) const noexcept
+			-> const V*
+		{
+			if(!mSlots.empty()) {
+				auto hash = Hash(key);
+				auto mask = mSlots.size() - 1;
+				auto check = Check(hash);
+				for(auto j = hash & mask; mSlots[j].index; j = (j + 1) & mask) {
+					if(mSlots[j].check == check) {
+						auto& e = mExact[mSlots[j].index - 1];
+						if(e.key == key) {
+							return &e.value;
+						}
+					}
+				}
+			}
+
+			if(mPrefixes.empty()) {
+				return nullptr;
+			}
+
+			// Zero-padded heads order strings the same way the strings do,
+			// except that equal heads leave it to the strings to decide.
+			auto head = Head(key);
+			std::size_t lo = 0;
+			for(auto n = mPrefixes.size(); n > 0;) {
+				auto half = n / 2;
+				auto mid = lo + half;
+				bool after = head > mHeads[mid];
+				if(head == mHeads[mid]) {
+					after = !(key < mPrefixes[mid].key);
+				}
+				lo += after ? half + 1 : 0;
+				n = after ? n - half - 1 : half;
+			}
+			if(lo == 0) {
+				return nullptr;
+			}
+			auto i = lo - 1;
+			std::string_view cand = mPrefixes[i].key;
+			auto n = std::min(cand.size(), key.size());
+			auto common = static_cast<std::size_t>(
+				std::mismatch(cand.begin(), cand.begin() + n, key.begin())
+					.first - cand.begin()
+				);
+			while(i != kNone && mPrefixes[i].key.size() > common) {
+				i = mPrefixes[i].parent;
+			}
+			return i == kNone ? nullptr : &mPrefixes[i].value;
+		}
+	template<typename V>
+		auto detail::KeyTable<V>::defaults() const -> KeyedDefaults<V> {
+			KeyedDefaults<V> defaults;
+			for(auto& e: mExact) {
+				defaults.set(e.key, e.value);
+			}
+			for(auto& p: mPrefixes) {
+				defaults.setPrefix(p.key, p.value);
+			}
+			return defaults;
+		}
+
+	//---- KeyedOptArg ---------------------------------------------------------
+
+	template<typename T>
+		auto KeyedOptArg<T>::GetDefault(std::string_view key) noexcept
+			-> const TValue&
+		{
+			auto p = FindKeyDefault(key);
+			return p ? *p : OptArg<T>::GetDefault();
+		}
+	template<typename T>
+		auto KeyedOptArg<T>::FindKeyDefault(std::string_view key) noexcept
+			-> const TValue*
+		{
+			using TRoot = detail::KeyedRoot<T,TValue>;
+			auto table = TRoot::sTable.load(std::memory_order_acquire);
+			return table ? table->find(key) : nullptr;
+		}
+	template<typename T>
+		auto KeyedOptArg<T>::GetKeyDefaults() -> TDefaults {
+			using TRoot = detail::KeyedRoot<T,TValue>;
+			auto& pub = TRoot::ThePublished();
+			std::lock_guard<std::mutex> lock{pub.mutex};
+			auto table = TRoot::sTable.load(std::memory_order_relaxed);
+			return table ? table->defaults() : TDefaults{};
+		}
+	template<typename T> template<typename Fn>
+		void KeyedOptArg<T>::Update(Fn&& fn) {
+			using TRoot = detail::KeyedRoot<T,TValue>;
+			auto& pub = TRoot::ThePublished();
+			std::lock_guard<std::mutex> lock{pub.mutex};
+			auto table = std::make_unique<const typename TRoot::TTable>(
+				fn(TRoot::sTable.load(std::memory_order_relaxed))
+				);
+			pub.tables.reserve(pub.tables.size() + 1);
+			TRoot::sTable.store(table.get(), std::memory_order_release);
+			pub.tables.push_back(std::move(table));
+		}
+	template<typename T>
+		void KeyedOptArg<T>::SetKeyDefaults(const TDefaults& defaults) {
+			Update([&defaults](auto) { return defaults; });
+		}
+	template<typename T>
+		void KeyedOptArg<T>::SetKeyDefault(std::string key, TValue v) {
+			Update([&](auto old) {
+				auto defaults = old ? old->defaults() : TDefaults{};
+				defaults.set(std::move(key), std::move(v));
+				return defaults;
+			});
+		}
+	template<typename T>
+		void KeyedOptArg<T>::SetPrefixDefault(std::string prefix, TValue v) {
+			Update([&](auto old) {
+				auto defaults = old ? old->defaults() : TDefaults{};
+				defaults.setPrefix(std::move(prefix), std::move(v));
+				return defaults;
+			});
+		}
+	template<typename T>
+		void KeyedOptArg<T>::ClearKeyDefault(std::string_view key) {
+			Update([key](auto old) {
+				auto defaults = old ? old->defaults() : TDefaults{};
+				defaults.erase(key);
+				return defaults;
+			});
+		}
+	template<typename T>
+		void KeyedOptArg<T>::ClearPrefixDefault(std::string_view prefix) {
+			Update([prefix](auto old) {
+				auto defaults = old ? old->defaults() : TDefaults{};
+				defaults.erasePrefix(prefix);
+				return defaults;
+			});
+		}
+}
+
+#endif
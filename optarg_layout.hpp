@@ -0,0 +1,310 @@
+#ifndef OPTARG_LAYOUT_HPP
+#define OPTARG_LAYOUT_HPP
+
+/**
+optarg_layout
+
+This companion to optarg.hpp finds out which tags your program reads together,
+so that a later build can put those tags next to each other in memory. It gets
+included automatically when the OPTARG_LAYOUT_PROFILE macro is set to 1.
+
+Only tags in a group (see TagTraits) can be rearranged, since the linker
+decides where everything else goes. So the idea is to put the tags of a hot
+code path in a group of their own, and then:
+
+	1. Build with -DOPTARG_LAYOUT_PROFILE=1 and run a representative workload.
+	2. Before the program exits, write out what it saw:
+
+		std::ofstream out{"tag_layout.inc"};
+		oarg::WriteLayoutSpec(out);
+
+	3. Build again with -DOPTARG_LAYOUT_FILE='"tag_layout.inc"' (and without
+	   OPTARG_LAYOUT_PROFILE).
+
+Each group's per-thread block then starts with its tags in the order the
+profile suggests. That order is built greedily: the most-read tag of the group
+goes first, then whichever tag was most often read together with the last few
+placed, and so on. Two reads count as together if no more than 7 other tags
+were read in between on the same thread.
+
+The file is plain text, one OPTARG_LAYOUT_ENTRY line per tag, so you can edit
+it by hand or keep it under version control. It lists groups and tags by their
+typeid names, so it only fits builds by the same compiler. The file also notes
+the most-read tags that are in no group, as candidates for one.
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace oarg {
+
+	/**
+	WriteLayoutSpec function
+
+	Writes out a layout file based on the reads tallied so far on all threads,
+	including ones that have exited.
+	**/
+	void WriteLayoutSpec(std::ostream& out);
+
+	namespace detail {
+
+		/*
+		Coaccess tallies reads per thread. Each thread keeps its counts in
+		a Node, along with a short most-recently-read list from which pairs
+		are counted. Nodes sit in an intrusive list so that WriteLayoutSpec
+		can find them, and fold their counts into the retired totals when
+		their threads exit. Each node has its own mutex, which only ever gets
+		contended while WriteLayoutSpec is reading it.
+		*/
+		class Coaccess {
+		public:
+			static constexpr std::size_t kWindow = 8;
+
+			struct TagStat {
+				const char* group; // null if ungrouped
+				const char* tag;
+				const char* name;
+				std::size_t size, align;
+			};
+			struct Counts {
+				std::vector<std::uint64_t> reads;
+				std::unordered_map<std::uint64_t, std::uint64_t> pairs;
+
+				void add(const Counts& other);
+			};
+
+			static auto Id(const TagStat& stat) -> std::uint32_t;
+			static void Note(std::uint32_t id);
+			static auto Snapshot() -> std::pair<std::vector<TagStat>, Counts>;
+
+			static auto PairKey(std::uint32_t a, std::uint32_t b) noexcept
+				-> std::uint64_t
+			{
+				if(a > b) {
+					std::swap(a, b);
+				}
+				return std::uint64_t{a} << 32 | b;
+			}
+
+		private:
+			struct Node {
+				Node();
+				~Node();
+
+				std::mutex mutex;
+				Counts counts;
+				std::array<std::uint32_t, kWindow> recent;
+				std::size_t nRecent = 0;
+				Node* prev = nullptr;
+				Node* next = nullptr;
+			};
+			struct State {
+				std::mutex mutex;
+				std::vector<TagStat> tags;
+				Node* head = nullptr;
+				Counts retired;
+			};
+
+			static auto TheState() -> State&;
+		};
+	}
+
+	//==== Implementation ======================================================
+
+	//---- NoteAccess ----------------------------------------------------------
+
+	template<typename T>
+		void detail::NoteAccess() noexcept {
+			using G = typename TagTraits<T>::TGroup;
+			using V = typename T::type;
+			static const auto id = [] {
+				const char* group = nullptr;
+				if constexpr(!std::is_void_v<G>) {
+					group = typeid(G).name();
+				}
+				auto tag = typeid(T).name();
+				return Coaccess::Id(Coaccess::TagStat{
+					group, tag, TagName<T>::Get(tag), sizeof(V), alignof(V)
+					});
+			}();
+			Coaccess::Note(id);
+		}
+
+	//---- Coaccess ------------------------------------------------------------
+
+	inline void detail::Coaccess::Counts::add(const Counts& other) {
+			if(reads.size() < other.reads.size()) {
+				reads.resize(other.reads.size());
+			}
+			for(std::size_t i = 0; i < other.reads.size(); ++i) {
+				reads[i] += other.reads[i];
+			}
+			for(auto& [key, n]: other.pairs) {
+				pairs[key] += n;
+			}
+		}
+	inline auto detail::Coaccess::TheState() -> State& {
+			static State state;
+			return state;
+		}
+	inline detail::Coaccess::Node::Node() {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			next = st.head;
+			if(next) {
+				next->prev = this;
+			}
+			st.head = this;
+		}
+	inline detail::Coaccess::Node::~Node() {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.retired.add(counts);
+			(prev ? prev->next : st.head) = next;
+			if(next) {
+				next->prev = prev;
+			}
+		}
+	inline auto detail::Coaccess::Id(const TagStat& stat) -> std::uint32_t {
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.tags.push_back(stat);
+			return static_cast<std::uint32_t>(st.tags.size() - 1);
+		}
+	inline void detail::Coaccess::Note(std::uint32_t id) {
+			thread_local Node node;
+			std::lock_guard<std::mutex> lock{node.mutex};
+			auto& c = node.counts;
+			if(c.reads.size() <= id) {
+				c.reads.resize(id + 1);
+			}
+			++c.reads[id];
+
+			// Count a pair with each tag in the recent list, then move this
+			// tag to the front of it.
+			auto& recent = node.recent;
+			if(node.nRecent > 0 && recent[0] == id) {
+				return;
+			}
+			auto end = node.nRecent;
+			for(std::size_t i = 0; i < node.nRecent; ++i) {
+				if(recent[i] == id) {
+					end = i;
+				}
+				else {
+					++c.pairs[PairKey(recent[i], id)];
+				}
+			}
+			if(end == node.nRecent && node.nRecent < kWindow) {
+				++node.nRecent;
+			}
+			for(auto i = std::min(end, kWindow - 1); i > 0; --i) {
+				recent[i] = recent[i - 1];
+			}
+			recent[0] = id;
+		}
+	inline auto detail::Coaccess::Snapshot()
+		-> std::pair<std::vector<TagStat>, Counts>
+		{
+			auto& st = TheState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			Counts total = st.retired;
+			for(auto p = st.head; p; p = p->next) {
+				std::lock_guard<std::mutex> nodeLock{p->mutex};
+				total.add(p->counts);
+			}
+			total.reads.resize(st.tags.size());
+			return {st.tags, std::move(total)};
+		}
+
+	//---- WriteLayoutSpec -----------------------------------------------------
+
+	inline void WriteLayoutSpec(std::ostream& out) {
+			using TCoaccess = detail::Coaccess;
+			constexpr std::size_t kLookBack = 4;
+
+			auto [tags, counts] = TCoaccess::Snapshot();
+			auto weight = [&counts = counts](std::uint32_t a, std::uint32_t b) {
+				auto it = counts.pairs.find(TCoaccess::PairKey(a, b));
+				return it == counts.pairs.end() ? 0 : it->second;
+			};
+
+			// Tags by group, each group's tags hottest first.
+			std::vector<std::uint32_t> byReads(tags.size());
+			for(std::uint32_t i = 0; i < tags.size(); ++i) {
+				byReads[i] = i;
+			}
+			std::stable_sort(byReads.begin(), byReads.end(),
+				[&counts = counts](std::uint32_t a, std::uint32_t b) {
+					return counts.reads[a] > counts.reads[b];
+				});
+
+			out << "// Tag layout written by oarg::WriteLayoutSpec. Build\n"
+				"// with OPTARG_LAYOUT_FILE naming this file to apply it.\n";
+			std::vector<bool> done(tags.size());
+			for(auto first: byReads) {
+				auto group = tags[first].group;
+				if(!group || done[first]) {
+					continue;
+				}
+				std::vector<std::uint32_t> rest;
+				for(auto i: byReads) {
+					if(tags[i].group && !std::strcmp(tags[i].group, group)) {
+						rest.push_back(i);
+						done[i] = true;
+					}
+				}
+				out << "\n// group " << group << '\n';
+				std::vector<std::uint32_t> order;
+				while(!rest.empty()) {
+					auto best = rest.begin();
+					std::uint64_t bestWeight = 0;
+					auto from = order.size() > kLookBack ?
+						order.end() - kLookBack : order.begin();
+					for(auto it = rest.begin(); it != rest.end(); ++it) {
+						std::uint64_t w = 0;
+						for(auto p = from; p != order.end(); ++p) {
+							w += weight(*p, *it);
+						}
+						if(w > bestWeight) {
+							best = it;
+							bestWeight = w;
+						}
+					}
+					auto& t = tags[*best];
+					out << "OPTARG_LAYOUT_ENTRY(\"" << t.group << "\", \""
+						<< t.tag << "\", " << t.size << ", " << t.align
+						<< ") // " << t.name << ": "
+						<< counts.reads[*best] << " reads\n";
+					order.push_back(*best);
+					rest.erase(best);
+				}
+			}
+
+			bool any = false;
+			for(auto i: byReads) {
+				if(tags[i].group || counts.reads[i] == 0) {
+					continue;
+				}
+				if(!any) {
+					out << "\n// Most-read tags in no group:\n";
+					any = true;
+				}
+				out << "//   " << tags[i].name << ": " << counts.reads[i]
+					<< " reads\n";
+			}
+		}
+}
+
+#endif
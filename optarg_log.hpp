@@ -0,0 +1,112 @@
+#ifndef OPTARG_LOG_HPP
+#define OPTARG_LOG_HPP
+
+/**
+optarg_log
+
+This companion to optarg.hpp defines a standard log-level tag, so that hot code
+can check its verbosity without much more than a single byte load, and so that
+you can turn up verbosity for the duration of one request with a WithDefArg:
+
+	void HandleRequest(const Request& req) {
+		std::optional<oarg::WithDefArg<oarg::LogLevel>> verbose;
+		if(req.traced()) {
+			verbose.emplace(oarg::kLogLevel::Trace);
+		}
+		...
+		OPTARG_LOG_IF(Debug) std::clog << "parsed " << req << '\n';
+	}
+
+There are two levels of filtering here:
+
+	1. A compile-time floor, given by the OPTARG_LOG_MIN_LEVEL macro (see
+	   below). Statements below the floor sit in the discarded branch of an
+	   if constexpr and generate no code at all, not even the level check.
+	2. The calling thread's LogLevel default. Since LogLevel is a plain
+	   thread_local real-time tag, this check compiles down to one load of a
+	   byte and a compare.
+
+Note that the level is per thread like any other default. New threads start
+at kLogLevel::Info.
+
+Configuration macros:
+	OPTARG_LOG_MIN_LEVEL 0:
+		The numeric value of the least severe kLogLevel that gets compiled in.
+		The default of 0 keeps everything (Trace and up). Setting it to 2, for
+		example, would strip out Trace and Debug statements.
+**/
+
+#include "optarg.hpp"
+
+#include <cstdint>
+
+#ifndef OPTARG_LOG_MIN_LEVEL
+	#define OPTARG_LOG_MIN_LEVEL 0
+#endif
+
+/**
+OPTARG_LOG_IF macro
+
+Put this in front of a log statement, passing the name of a kLogLevel
+enumerator. The statement runs only if the level passes both the compile-time
+floor and the calling thread's LogLevel default.
+
+	OPTARG_LOG_IF(Warn) std::clog << "retrying " << host << '\n';
+
+Since the macro expands to an if/else chain that ends in a bare else, it is
+safe to use ahead of an if statement of your own without dangling-else
+surprises.
+**/
+#define OPTARG_LOG_IF(level) \
+	if constexpr(!::oarg::LogCompiled(::oarg::kLogLevel::level)) {} \
+	else if(!::oarg::LogEnabled<::oarg::kLogLevel::level>()) {} \
+	else
+
+namespace oarg {
+
+	enum class kLogLevel: std::uint8_t {
+		Trace, Debug, Info, Warn, Error, Fatal, Off
+	};
+
+	/**
+	LogLevel tag
+
+	Use this tag with OptArg and WithDefArg like any other. Its value type is
+	a CustomDef<kLogLevel,kLogLevel::Info>.
+	**/
+	struct LogLevel {
+		using type = CustomDef<kLogLevel,kLogLevel::Info>;
+		static constexpr bool realtime = true;
+		static constexpr const char* name = "log_level";
+	};
+
+	constexpr auto kMinLogLevel =
+		static_cast<kLogLevel>(OPTARG_LOG_MIN_LEVEL);
+
+	/**
+	LogCompiled function
+
+	Returns true if statements at the given level survive the compile-time
+	floor.
+
+	LogEnabled function template
+
+	Returns true if statements at the given level should run on the calling
+	thread right now. This is what OPTARG_LOG_IF checks at run-time, and you
+	can use it directly to guard anything costlier than a single statement.
+	**/
+	constexpr auto LogCompiled(kLogLevel level) noexcept -> bool {
+		return level >= kMinLogLevel;
+	}
+	template<kLogLevel Level>
+		inline auto LogEnabled() noexcept -> bool {
+			if constexpr(!LogCompiled(Level)) {
+				return false;
+			}
+			else {
+				return OptArg<LogLevel>::GetDefault() <= Level;
+			}
+		}
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef OPTARG_MMAP_HPP
+#define OPTARG_MMAP_HPP
+
+/**
+optarg_mmap
+
+This companion to optarg.hpp provides a default value type for large read-only
+data (lookup tables, vocabularies, and the like) that lives in a memory-mapped
+file rather than on the heap. The file is mapped read-only and shared, so the
+operating system pages it in lazily as it is touched, and all threads and
+processes mapping the same file share the same physical pages.
+
+	struct vocab { using type = oarg::MappedView; };
+
+	oarg::OptArg<vocab>::SetDefault(oarg::MapFile("/srv/vocab/en.bin"));
+	...
+	{
+		oarg::WithDefArg<vocab> de{oarg::MapFile("/srv/vocab/de.bin")};
+		Tokenize(text); // reads oarg::OptArg<vocab>::GetDefault()
+	}
+
+A MappedView is just a pointer and a length plus a shared reference to the
+mapping that keeps it alive, so copying one (which is what WithDefArg and each
+thread's initial copy amount to) never copies the data. The mapping goes away
+once the last view referring to it does.
+
+This header is POSIX-only.
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace oarg {
+
+	/**
+	MappedFile
+
+	Owns a read-only shared mapping of an entire file. You get one from
+	Open(), which throws std::system_error if the file cannot be opened or
+	mapped. An empty file gives you a MappedFile of size 0 with a null data
+	pointer.
+	**/
+	class MappedFile {
+	public:
+		static auto Open(const std::string& path)
+			-> std::shared_ptr<const MappedFile>;
+
+		MappedFile(const MappedFile&) = delete;
+		~MappedFile();
+
+		auto data() const noexcept -> const std::byte* { return mData; }
+		auto size() const noexcept -> std::size_t { return mSize; }
+
+	private:
+		MappedFile() noexcept = default;
+
+		const std::byte* mData = nullptr;
+		std::size_t mSize = 0;
+	};
+
+	/**
+	MappedView
+
+	A view of some range of bytes within a MappedFile. A default-constructed
+	view is empty and refers to no file.
+
+	Methods:
+		data/size/empty:
+			What you would expect. data() is null for an empty view.
+		subview:
+			Returns: a view of length bytes starting at offset within this
+				view, sharing the same file; length is clipped to what is
+				left, and an offset past the end throws std::out_of_range
+		text:
+			Returns: the view as a std::string_view
+		array:
+			Returns: the view as a pointer to T, for when the file holds an
+				array of some trivially copyable T. Which is to say, you are
+				responsible for the layout and alignment of the file matching
+				T. Divide size() by sizeof(T) to get the element count.
+		file:
+			Returns: the file the view refers to (null for an empty view)
+	**/
+	class MappedView {
+	public:
+		MappedView() noexcept = default;
+		explicit MappedView(std::shared_ptr<const MappedFile> file) noexcept;
+
+		auto data() const noexcept -> const std::byte* { return mData; }
+		auto size() const noexcept -> std::size_t { return mSize; }
+		auto empty() const noexcept -> bool { return mSize == 0; }
+
+		auto subview(
+			std::size_t offset, std::size_t length = std::string_view::npos
+			) const -> MappedView;
+		auto text() const noexcept -> std::string_view;
+		template<typename T>
+			auto array() const noexcept -> const T* {
+				static_assert(std::is_trivially_copyable_v<T>);
+				return reinterpret_cast<const T*>(mData);
+			}
+		auto file() const noexcept -> const std::shared_ptr<const MappedFile>&
+			{ return mFile; }
+
+	private:
+		std::shared_ptr<const MappedFile> mFile;
+		const std::byte* mData = nullptr;
+		std::size_t mSize = 0;
+	};
+
+	/**
+	MapFile function
+
+	A shorthand for MappedView{MappedFile::Open(path)}.
+	**/
+	auto MapFile(const std::string& path) -> MappedView;
+
+	//==== Implementation ======================================================
+
+	inline auto MappedFile::Open(const std::string& path)
+		-> std::shared_ptr<const MappedFile>
+		{
+			auto fail = [&path]() {
+				throw std::system_error{
+					errno, std::generic_category(), "optarg mmap " + path
+					};
+			};
+			int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if(fd < 0) {
+				fail();
+			}
+			struct stat st;
+			if(::fstat(fd, &st) < 0) {
+				auto err = errno;
+				::close(fd);
+				errno = err;
+				fail();
+			}
+			std::shared_ptr<MappedFile> file{new MappedFile};
+			file->mSize = static_cast<std::size_t>(st.st_size);
+			if(file->mSize > 0) {
+				auto p = ::mmap(
+					nullptr, file->mSize, PROT_READ, MAP_SHARED, fd, 0
+					);
+				if(p == MAP_FAILED) {
+					auto err = errno;
+					::close(fd);
+					errno = err;
+					file->mSize = 0;
+					fail();
+				}
+				file->mData = static_cast<const std::byte*>(p);
+			}
+			::close(fd);
+			return file;
+		}
+	inline MappedFile::~MappedFile() {
+			if(mData) {
+				::munmap(const_cast<std::byte*>(mData), mSize);
+			}
+		}
+
+	inline MappedView::MappedView(std::shared_ptr<const MappedFile> file)
+		noexcept:
+		mFile{std::move(file)}
+		{
+			if(mFile) {
+				mData = mFile->data();
+				mSize = mFile->size();
+			}
+		}
+	inline auto MappedView::subview(std::size_t offset, std::size_t length)
+		const -> MappedView
+		{
+			if(offset > mSize) {
+				throw std::out_of_range{"optarg mapped view offset"};
+			}
+			MappedView view;
+			view.mFile = mFile;
+			view.mData = mData ? mData + offset : nullptr;
+			view.mSize = std::min(length, mSize - offset);
+			return view;
+		}
+	inline auto MappedView::text() const noexcept -> std::string_view {
+			return {reinterpret_cast<const char*>(mData), mSize};
+		}
+
+	inline auto MapFile(const std::string& path) -> MappedView {
+			return MappedView{MappedFile::Open(path)};
+		}
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef OPTARG_RANDOM_HPP
+#define OPTARG_RANDOM_HPP
+
+/**
+optarg_random
+
+This companion to optarg.hpp lets a random engine be a scoped default, in a way
+that keeps parallel code reproducible. The idea is that instead of sharing one
+engine between threads (which needs locking and makes results depend on
+scheduling), each task gets a stream of its own, split off deterministically
+from its parent's.
+
+	struct Rng { using type = oarg::SplitRng; };
+
+	void Simulate(std::size_t n) {
+		std::vector<oarg::SplitRng> streams;
+		for(std::size_t i = 0; i < n; ++i) {
+			streams.push_back(oarg::SplitDefault<Rng>());
+		}
+		ParallelFor(n, [&](std::size_t i) {
+			oarg::WithDefArg<Rng> rng{streams[i]};
+			Step(i); // draws from oarg::OptArg<Rng>::MutDefault()
+		});
+	}
+
+The streams get split off on the spawning thread, in a fixed order, so task i
+always draws the same numbers no matter how many worker threads there are or
+which one runs it. Step can itself use SplitDefault and WithDefArg to hand
+sub-streams to whatever it calls, and so on down.
+
+(Bear in mind that like any default, a new thread starts out with a
+default-constructed SplitRng, which is seeded with 0. Give each thread that
+draws numbers a stream explicitly as shown above.)
+
+SplitRng is an implementation of the SplitMix algorithm (Steele, Lea & Flood,
+"Fast Splittable Pseudorandom Number Generators", OOPSLA 2014), the one behind
+Java's SplittableRandom. It is 16 bytes, trivially copyable, and each draw
+is an add and a few shifts and multiplies. It is not meant for cryptography.
+**/
+
+#include "optarg.hpp"
+
+#include <cstdint>
+
+namespace oarg {
+
+	/**
+	SplitRng
+
+	A random engine meeting the UniformRandomBitGenerator requirements, so
+	that you can feed it to any of the std distributions.
+
+	Methods:
+		operator():
+			Returns the next 64 random bits and advances the engine.
+		split:
+			Advances the engine and returns a new one, whose output is
+			statistically independent of the rest of this engine's. Calling
+			split the same number of times in the same order on engines that
+			started out the same always gives the same children.
+	**/
+	class SplitRng {
+	public:
+		using result_type = std::uint64_t;
+
+		static constexpr auto min() noexcept -> result_type { return 0; }
+		static constexpr auto max() noexcept -> result_type {
+			return ~result_type{0};
+		 }
+
+		constexpr SplitRng() noexcept: SplitRng{0} {}
+		constexpr explicit SplitRng(std::uint64_t seed) noexcept:
+			mSeed{seed}, mGamma{kGoldenGamma} {}
+
+		constexpr auto operator() () noexcept -> result_type {
+			return Mix64(NextSeed());
+		 }
+		constexpr auto split() noexcept -> SplitRng {
+			auto seed = Mix64(NextSeed());
+			return SplitRng{seed, MixGamma(NextSeed())};
+		 }
+
+		friend constexpr auto operator== (
+			const SplitRng& a, const SplitRng& b) noexcept -> bool
+			{ return a.mSeed == b.mSeed && a.mGamma == b.mGamma; }
+		friend constexpr auto operator!= (
+			const SplitRng& a, const SplitRng& b) noexcept -> bool
+			{ return !(a == b); }
+
+	private:
+		static constexpr std::uint64_t kGoldenGamma = 0x9e3779b97f4a7c15u;
+
+		constexpr SplitRng(std::uint64_t seed, std::uint64_t gamma) noexcept:
+			mSeed{seed}, mGamma{gamma} {}
+
+		constexpr auto NextSeed() noexcept -> std::uint64_t {
+			return mSeed += mGamma;
+		 }
+		static constexpr auto Mix64(std::uint64_t z) noexcept
+			-> std::uint64_t;
+		static constexpr auto MixGamma(std::uint64_t z) noexcept
+			-> std::uint64_t;
+
+		std::uint64_t mSeed;
+		std::uint64_t mGamma;
+	};
+
+	/**
+	SplitDefault function template
+
+	Splits the calling thread's default for Tag, whose value type must have a
+	split() method like SplitRng's, and returns the new child. Pass the child
+	to a WithDefArg (on this thread or another) to make it the default there.
+
+		oarg::WithDefArg<Rng> sub{oarg::SplitDefault<Rng>()};
+
+	Note that the parent default advances as a result, so if the above sits in
+	a loop, each iteration gets a different stream.
+	**/
+	template<typename Tag>
+		auto SplitDefault() -> typename OptArg<Tag>::TValue {
+			return OptArg<Tag>::MutDefault().split();
+		}
+
+	//==== Implementation ======================================================
+
+	constexpr auto SplitRng::Mix64(std::uint64_t z) noexcept -> std::uint64_t {
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+			return z ^ (z >> 31);
+		}
+	constexpr auto SplitRng::MixGamma(std::uint64_t z) noexcept
+		-> std::uint64_t
+		{
+			z = (z ^ (z >> 33)) * 0xff51afd7ed558ccdu;
+			z = (z ^ (z >> 33)) * 0xc4ceb9fe1a85ec53u;
+			z = (z ^ (z >> 33)) | 1u;
+
+			// Gammas with too few bit transitions make for poor streams.
+			auto flips = z ^ (z >> 1);
+			int n = 0;
+			for(; flips; flips &= flips - 1) {
+				++n;
+			}
+			return n < 24 ? z ^ 0xaaaaaaaaaaaaaaaau : z;
+		}
+}
+
+#endif
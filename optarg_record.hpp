@@ -0,0 +1,484 @@
+#ifndef OPTARG_RECORD_HPP
+#define OPTARG_RECORD_HPP
+
+/**
+optarg_record
+
+This companion to optarg.hpp records changes to defaults as they happen and
+lets you play them back later. It is meant for chasing down bugs that depend on
+the exact order in which threads set and override their defaults.
+
+Recording is only available when OPTARG_RECORD is defined to 1 (see the
+configuration macros in optarg.hpp), in which case optarg.hpp includes this
+header for you. With the macro at 0, the hooks in optarg.hpp compile away and
+nothing in here gets used.
+
+	oarg::StartRecording("defaults.rec");
+	RunTheFlakyThing();
+	oarg::StopRecording();
+
+While recording is on, each SetDefault, SetRootDefault, and each construction
+and destruction of a WithDefArg appends a fixed-size 64-byte event to a ring
+belonging to the calling thread. The event holds a timestamp, a thread index,
+the tag, the kind of change, and the resulting default. Nothing is shared
+between threads at this point: the ring only gets written out to the file
+(under a lock) when it fills up, when its thread exits, or when you call
+FlushRecording or StopRecording.
+
+Values are captured byte-for-byte, so this only works for value types that are
+trivially copyable and no larger than 40 bytes. Events for other types are
+still recorded, but without their values, and replaying them does nothing.
+
+The file format is meant to be read by the Replayer class below on the same
+build of the same program. Tags are identified in the file by their
+typeid names.
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <typeinfo>
+#include <vector>
+
+namespace oarg {
+
+	/**
+	RecordedEvent
+
+	This is the on-disk layout of a single event, as well as what Replayer
+	hands back to you as it steps through a recording.
+
+	Data members:
+		time: the CPU timestamp counter (or steady_clock nanoseconds on
+			architectures without one)
+		tag: index of the tag, which you can turn into a name with
+			Replayer::tagName()
+		thread: index of the recording thread, in the order threads first
+			recorded something
+		seq: position of the event within its thread's history
+		op: the kind of change
+		size: the number of value bytes captured, or kUncaptured
+		value: the bytes of the resulting default
+	**/
+	struct RecordedEvent {
+		static constexpr std::uint8_t kUncaptured = 0xff;
+		static constexpr std::uint8_t kDefine = 0xff; // internal op
+
+		std::uint64_t time;
+		std::uint32_t tag;
+		std::uint32_t thread;
+		std::uint32_t seq;
+		kRecOp op;
+		std::uint8_t size;
+		std::uint8_t pad[2];
+		std::array<unsigned char,40> value;
+	};
+	static_assert(sizeof(RecordedEvent) == 64);
+
+	/**
+	StartRecording function
+
+	Opens (truncating) the file at path and starts recording into it. Any
+	recording already in progress gets stopped first. Throws
+	std::system_error if the file cannot be opened.
+
+	StopRecording function
+
+	Writes out the ring of every thread still running and closes the file.
+
+	FlushRecording function
+
+	Writes out the calling thread's ring. You may want to call this at the end
+	of a thread you are about to leave parked in a pool, since its ring is
+	otherwise only written when it fills up or the thread exits.
+	**/
+	void StartRecording(const std::string& path);
+	void StopRecording() noexcept;
+	void FlushRecording() noexcept;
+
+	/**
+	Replayer
+
+	A Replayer loads a recording and applies its events, in timestamp order, to
+	the defaults of the calling thread. Before you can replay a tag's events,
+	you need to bind the tag so that the Replayer knows how to turn the
+	recorded bytes back into a value:
+
+		oarg::Replayer rp{"defaults.rec"};
+		rp.bind<MaxConns>().bind<Verbose>();
+		while(auto e = rp.step()) {
+			CheckInvariants(); // sees the defaults as they were after *e
+		}
+
+	Events of tags you have not bound are stepped over without being applied.
+
+	Replaying everything on one thread folds the histories of all recorded
+	threads together. That is usually what you want when checking how a
+	sequence of changes interleaved, but if you need to reproduce what a
+	single thread saw, pass its index to only(). The Replayer then skips the
+	events of every other thread.
+
+	Set and Enter/Exit events are applied with SetDefault, using the default
+	recorded after the change. (Enter and Exit are not applied as WithDefArg
+	scopes since the scopes of different recorded threads need not nest on the
+	replaying thread.) SetRoot events are applied with SetRootDefault.
+	**/
+	class Replayer {
+	public:
+		explicit Replayer(const std::string& path);
+
+		template<typename Tag> auto bind() -> Replayer&;
+		auto only(std::optional<std::uint32_t> thread) -> Replayer&;
+
+		auto step() -> const RecordedEvent*;
+		void run();
+		void rewind() noexcept { mNext = 0; }
+
+		auto events() const noexcept -> const std::vector<RecordedEvent>&
+			{ return mEvents; }
+		auto tagName(std::uint32_t tag) const -> const std::string&;
+
+	private:
+		using TApply = void(*)(const RecordedEvent&);
+
+		std::vector<RecordedEvent> mEvents;
+		std::vector<std::string> mNames;
+		std::vector<TApply> mApply;
+		std::optional<std::uint32_t> mOnly;
+		std::size_t mNext = 0;
+	};
+
+	namespace detail {
+
+		/*
+		RecState holds the output file. Its session number changes on every
+		start or stop, which lets a thread's ring tell that the events it
+		holds belong to a recording that is no longer current and should be
+		dropped rather than written.
+		*/
+		struct RecState {
+			std::mutex mutex;
+			std::FILE* file = nullptr;
+			std::atomic<bool> active{false};
+			std::atomic<std::uint32_t> session{0};
+			std::atomic<std::uint32_t> threads{0};
+			std::atomic<std::uint32_t> tags{0};
+		};
+		inline auto TheRecState() noexcept -> RecState& {
+			static RecState state;
+			return state;
+		}
+
+		inline auto RecordClock() noexcept -> std::uint64_t {
+		#if defined(__x86_64__) || defined(__i386__)
+			return __builtin_ia32_rdtsc();
+		#else
+			return static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()
+					).count()
+				);
+		#endif
+		}
+
+		// The caller must hold the RecState mutex.
+		inline void RecWrite(
+			RecState& st, const void* data, std::size_t n) noexcept
+		{
+			if(st.file) {
+				std::fwrite(data, 1, n, st.file);
+			}
+		}
+
+		class RecRing {
+		public:
+			static constexpr std::size_t kSize = 256;
+
+			static auto This() noexcept -> RecRing& {
+				thread_local RecRing ring;
+				return ring;
+			}
+			~RecRing() { flush(); }
+
+			auto next(std::uint32_t session) noexcept -> RecordedEvent& {
+				if(session != mSession) {
+					mCount = 0;
+					mSession = session;
+				}
+				auto& e = mEvents[mCount];
+				e.thread = mThread;
+				e.seq = mSeq++;
+				e.pad[0] = e.pad[1] = 0;
+				return e;
+			}
+			void commit() noexcept {
+				if(++mCount == kSize) {
+					flush();
+				}
+			}
+			void flush() noexcept {
+				if(mCount == 0) {
+					return;
+				}
+				auto& st = TheRecState();
+				std::lock_guard<std::mutex> lock{st.mutex};
+				if(mSession == st.session.load(std::memory_order_relaxed)) {
+					RecWrite(
+						st, mEvents.data(), mCount * sizeof(RecordedEvent)
+						);
+				}
+				mCount = 0;
+			}
+
+		private:
+			RecRing() noexcept:
+				mThread{TheRecState().threads.fetch_add(
+					1, std::memory_order_relaxed
+					)}
+				{}
+
+			std::array<RecordedEvent,kSize> mEvents;
+			std::size_t mCount = 0;
+			std::uint32_t mThread;
+			std::uint32_t mSeq = 0;
+			std::uint32_t mSession = 0;
+		};
+
+		/*
+		Each tag gets a process-wide index the first time it records
+		anything. The name of the tag is written out to the file (as a define
+		event followed by the name itself, padded out to whole events) once
+		per recording session, the first time the tag appears in it.
+		*/
+		template<typename Tag>
+			struct RecTag {
+				static auto Id(std::uint32_t session) noexcept -> std::uint32_t
+				{
+					static const std::uint32_t id =
+						TheRecState().tags.fetch_add(
+							1, std::memory_order_relaxed
+							);
+					if(sSession.load(std::memory_order_acquire) != session) {
+						Define(id, session);
+					}
+					return id;
+				}
+			private:
+				static void Define(
+					std::uint32_t id, std::uint32_t session) noexcept;
+				static inline std::atomic<std::uint32_t> sSession{0};
+			};
+
+	}
+
+	//==== Template Implementation =============================================
+
+	//---- Record --------------------------------------------------------------
+
+	template<typename Tag, typename Value>
+		void detail::Record(kRecOp op, const Value& v) noexcept {
+			auto& st = TheRecState();
+			if(!st.active.load(std::memory_order_relaxed)) {
+				return;
+			}
+			auto session = st.session.load(std::memory_order_relaxed);
+			auto tag = RecTag<Tag>::Id(session);
+			auto& ring = RecRing::This();
+			auto& e = ring.next(session);
+			e.time = RecordClock();
+			e.tag = tag;
+			e.op = op;
+			if constexpr(
+				std::is_trivially_copyable_v<Value> &&
+				sizeof(Value) <= sizeof e.value)
+			{
+				e.size = static_cast<std::uint8_t>(sizeof(Value));
+				std::memcpy(e.value.data(), &v, sizeof(Value));
+			}
+			else {
+				e.size = RecordedEvent::kUncaptured;
+			}
+			ring.commit();
+		}
+
+	//---- RecTag --------------------------------------------------------------
+
+	template<typename Tag>
+		void detail::RecTag<Tag>::Define(
+			std::uint32_t id, std::uint32_t session) noexcept
+		{
+			auto& st = TheRecState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			if(session != st.session.load(std::memory_order_relaxed) ||
+				sSession.load(std::memory_order_relaxed) == session)
+			{
+				return;
+			}
+			const char* name = typeid(Tag).name();
+			auto len = std::strlen(name);
+			RecordedEvent e{};
+			e.tag = id;
+			e.seq = static_cast<std::uint32_t>(len);
+			e.op = static_cast<kRecOp>(RecordedEvent::kDefine);
+			RecWrite(st, &e, sizeof e);
+			std::vector<char> padded(
+				(len + sizeof e - 1) / sizeof e * sizeof e
+				);
+			std::memcpy(padded.data(), name, len);
+			RecWrite(st, padded.data(), padded.size());
+			sSession.store(session, std::memory_order_release);
+		}
+
+	//---- Replayer ------------------------------------------------------------
+
+	template<typename Tag>
+		auto Replayer::bind() -> Replayer& {
+			using TOptArg = OptArg<Tag>;
+			using TValue = typename TOptArg::TValue;
+			using TSlot = typename Tag::type;
+			TApply apply = [](const RecordedEvent& e) {
+				if constexpr(
+					std::is_trivially_copyable_v<TSlot> &&
+					std::is_default_constructible_v<TSlot>)
+				{
+					if(e.size != sizeof(TSlot)) {
+						return;
+					}
+					TSlot slot;
+					std::memcpy(&slot, e.value.data(), sizeof slot);
+					const TValue& v = slot;
+					if constexpr(TagTraits<Tag>::kProcessRoot) {
+						if(e.op == kRecOp::SetRoot) {
+							TOptArg::SetRootDefault(v);
+							return;
+						}
+					}
+					TOptArg::SetDefault(v);
+				}
+			};
+			auto name = typeid(Tag).name();
+			for(std::size_t i = 0; i < mNames.size(); ++i) {
+				if(mNames[i] == name) {
+					mApply[i] = apply;
+				}
+			}
+			return *this;
+		}
+
+	//==== Implementation ======================================================
+
+	inline void StartRecording(const std::string& path) {
+			StopRecording();
+			auto& st = detail::TheRecState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.file = std::fopen(path.c_str(), "wb");
+			if(!st.file) {
+				throw std::system_error{
+					errno, std::generic_category(), "optarg recording"
+					};
+			}
+			st.session.fetch_add(1, std::memory_order_relaxed);
+			st.active.store(true, std::memory_order_relaxed);
+		}
+	inline void StopRecording() noexcept {
+			auto& st = detail::TheRecState();
+			FlushRecording();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			st.active.store(false, std::memory_order_relaxed);
+			if(st.file) {
+				std::fclose(st.file);
+				st.file = nullptr;
+			}
+			st.session.fetch_add(1, std::memory_order_relaxed);
+		}
+	inline void FlushRecording() noexcept {
+			detail::RecRing::This().flush();
+			auto& st = detail::TheRecState();
+			std::lock_guard<std::mutex> lock{st.mutex};
+			if(st.file) {
+				std::fflush(st.file);
+			}
+		}
+
+	inline Replayer::Replayer(const std::string& path) {
+			std::unique_ptr<std::FILE,int(*)(std::FILE*)> file{
+				std::fopen(path.c_str(), "rb"), &std::fclose
+				};
+			if(!file) {
+				throw std::system_error{
+					errno, std::generic_category(), "optarg recording"
+					};
+			}
+			RecordedEvent e;
+			while(std::fread(&e, sizeof e, 1, file.get()) == 1) {
+				if(static_cast<std::uint8_t>(e.op) != RecordedEvent::kDefine) {
+					mEvents.push_back(e);
+					continue;
+				}
+				std::string name(
+					(e.seq + sizeof e - 1) / sizeof e * sizeof e, '\0'
+					);
+				if(std::fread(name.data(), 1, name.size(), file.get()) !=
+					name.size())
+				{
+					break;
+				}
+				name.resize(e.seq);
+				if(mNames.size() <= e.tag) {
+					mNames.resize(e.tag + 1);
+					mApply.resize(e.tag + 1);
+				}
+				mNames[e.tag] = std::move(name);
+			}
+			std::sort(mEvents.begin(), mEvents.end(),
+				[](const RecordedEvent& a, const RecordedEvent& b) {
+					if(a.time != b.time) {
+						return a.time < b.time;
+					}
+					if(a.thread != b.thread) {
+						return a.thread < b.thread;
+					}
+					return a.seq < b.seq;
+				});
+		}
+	inline auto Replayer::only(std::optional<std::uint32_t> thread)
+		-> Replayer&
+		{
+			mOnly = thread;
+			return *this;
+		}
+	inline auto Replayer::step() -> const RecordedEvent* {
+			while(mNext < mEvents.size()) {
+				auto& e = mEvents[mNext++];
+				if(mOnly && e.thread != *mOnly) {
+					continue;
+				}
+				if(e.tag < mApply.size() && mApply[e.tag]) {
+					mApply[e.tag](e);
+				}
+				return &e;
+			}
+			return nullptr;
+		}
+	inline void Replayer::run() {
+			while(step()) {}
+		}
+	inline auto Replayer::tagName(std::uint32_t tag) const
+		-> const std::string&
+		{
+			static const std::string unknown;
+			return tag < mNames.size() ? mNames[tag] : unknown;
+		}
+}
+
+#endif
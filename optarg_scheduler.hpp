@@ -0,0 +1,508 @@
+#ifndef OPTARG_SCHEDULER_HPP
+#define OPTARG_SCHEDULER_HPP
+
+/**
+optarg_scheduler
+
+This companion to optarg.hpp provides a thread pool whose tasks run in order of
+priority, where the priority of a task is simply the Priority default of the
+thread that submitted it. So a section of code can raise (or lower) the
+priority of everything it submits without any submit call sites changing:
+
+	oarg::PriorityPool pool;
+
+	void HandleInteractive(const Request& req) {
+		oarg::WithDefArg<oarg::Priority> p{oarg::kPriority::High};
+		Render(req); // calls pool.submit(...) somewhere deep down
+	}
+
+A task runs with its priority installed as the Priority default of the worker
+running it, so anything it submits in turn inherits that priority too.
+
+Each priority level has a bounded lock-free queue of its own, and an idle worker
+takes the next task from whichever level scores highest, where a level's score
+is its priority plus one for every aging interval its oldest task has been
+waiting. With the default interval of 10ms, a Low task that has waited 20ms
+competes with a fresh High task, so no level starves under sustained load from
+above.
+
+To see how the levels fare under load, latency() reports percentiles of the
+time tasks spent queued, by priority:
+
+	auto lat = pool.latency(oarg::kPriority::Low);
+	std::cout << "p99 " << lat.p99.count() << "ns over " << lat.count << '\n';
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace oarg {
+
+	enum class kPriority: std::uint8_t { Low, Normal, High };
+	constexpr std::size_t kNumPriorities = 3;
+
+	/**
+	Priority tag
+
+	Use this tag with OptArg and WithDefArg like any other. Its value type is
+	a CustomDef<kPriority,kPriority::Normal>.
+	**/
+	struct Priority {
+		using type = CustomDef<kPriority,kPriority::Normal>;
+		static constexpr bool realtime = true;
+		static constexpr const char* name = "priority";
+	};
+
+	/**
+	LatencyStats
+
+	Percentiles of the time tasks spent queued, from submission until a
+	worker started running them. The percentiles are accurate to within
+	about 12%, erring on the high side. max is exact.
+	**/
+	struct LatencyStats {
+		std::uint64_t count = 0;
+		std::chrono::nanoseconds p50{}, p90{}, p99{}, p999{}, max{};
+	};
+
+	/**
+	PriorityPool
+
+	Constructor:
+		threads: the number of worker threads (0 for one per core)
+		capacity: the most tasks each priority level can hold at once
+			(rounded up to a power of 2)
+		aging: how long a task must wait to gain one priority level
+			(0 for strict priority, which can starve the lower levels)
+
+	Destructor:
+		Runs whatever tasks are still queued, then joins the workers.
+
+	Methods:
+		submit:
+			Queues a task at the calling thread's Priority default, or at the
+			priority you give. If the level is full, submit waits for room,
+			except when called from one of the pool's own workers, in which
+			case it runs the task right away instead (so that workers never
+			wait on each other). A task must not let an exception escape; if
+			one does, std::terminate gets called.
+		trySubmit:
+			Like submit, but returns false instead of waiting when the level
+			is full, leaving the task where it was.
+		latency:
+			Returns: LatencyStats for the tasks started so far at the given
+				priority (tasks submit ran right away count as 0ns)
+	**/
+	class PriorityPool {
+	public:
+		using TTask = std::function<void()>;
+
+		explicit PriorityPool(
+			std::size_t threads = 0, std::size_t capacity = 1024,
+			std::chrono::nanoseconds aging = std::chrono::milliseconds{10}
+			);
+		PriorityPool(const PriorityPool&) = delete;
+		~PriorityPool();
+
+		void submit(TTask task);
+		void submit(kPriority priority, TTask task);
+		auto trySubmit(TTask& task) -> bool;
+		auto trySubmit(kPriority priority, TTask& task) -> bool;
+
+		auto latency(kPriority priority) const -> LatencyStats;
+
+	private:
+		/*
+		TaskQueue is Dmitry Vyukov's bounded MPMC queue. Each cell carries
+		a sequence number that tells producers and consumers whose turn it
+		is, so that pushes and pops each cost one compare-and-swap in the
+		common case.
+
+		Each cell also carries the time its task was queued. headSince reads
+		that of the oldest task without taking it, for aging purposes. Since
+		the head may get popped in the meantime, the answer is only a hint,
+		which is why the field is atomic.
+		*/
+		class TaskQueue {
+		public:
+			explicit TaskQueue(std::size_t capacity);
+
+			auto tryPush(TTask& task, std::int64_t since) -> bool;
+			auto tryPop(TTask& task, std::int64_t& since) -> bool;
+			auto headSince() const noexcept -> std::optional<std::int64_t>;
+
+		private:
+			struct Cell {
+				std::atomic<std::size_t> seq;
+				std::atomic<std::int64_t> since;
+				TTask task;
+			};
+
+			std::unique_ptr<Cell[]> mCells;
+			std::size_t mMask;
+			alignas(64) std::atomic<std::size_t> mHead{0};
+			alignas(64) std::atomic<std::size_t> mTail{0};
+		};
+
+		/*
+		Histogram buckets latencies on a log-linear scale: 8 buckets for
+		each power of 2. Only the owning worker ever writes to one, so
+		relaxed loads and stores suffice. They are atomic only so that
+		latency() may read them from another thread.
+		*/
+		struct Histogram {
+			static constexpr std::size_t kBuckets = 512;
+
+			std::array<std::atomic<std::uint64_t>, kBuckets> counts{};
+			std::atomic<std::uint64_t> max{0};
+
+			void add(std::uint64_t ns) noexcept;
+			static auto Bucket(std::uint64_t ns) noexcept -> std::size_t;
+			static auto Upper(std::size_t bucket) noexcept -> std::uint64_t;
+		};
+		struct Worker {
+			std::array<Histogram, kNumPriorities> waits;
+			std::thread thread;
+		};
+
+		static auto Now() noexcept -> std::int64_t;
+		void work(Worker& self);
+		auto pick(TTask& task, std::int64_t& since, std::size_t& level)
+			-> bool;
+		static void Run(
+			Worker& self, std::size_t level, TTask& task, std::int64_t since
+			) noexcept;
+
+		static inline thread_local const PriorityPool* tlPool = nullptr;
+		static inline thread_local Worker* tlWorker = nullptr;
+
+		std::int64_t mAging;
+		std::vector<std::unique_ptr<TaskQueue>> mQueues;
+		std::vector<std::unique_ptr<Worker>> mWorkers;
+		std::atomic<std::int64_t> mPending{0};
+		std::atomic<std::size_t> mSleepers{0};
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		bool mStop = false;
+	};
+
+	//==== Implementation ======================================================
+
+	//---- TaskQueue -----------------------------------------------------------
+
+	inline PriorityPool::TaskQueue::TaskQueue(std::size_t capacity) {
+			std::size_t n = 2;
+			while(n < capacity) {
+				n *= 2;
+			}
+			mCells.reset(new Cell[n]);
+			mMask = n - 1;
+			for(std::size_t i = 0; i < n; ++i) {
+				mCells[i].seq.store(i, std::memory_order_relaxed);
+				mCells[i].since.store(0, std::memory_order_relaxed);
+			}
+		}
+	inline auto PriorityPool::TaskQueue::tryPush(
+		TTask& task, std::int64_t since
+		) -> bool
+		{
+			Cell* cell;
+			auto pos = mTail.load(std::memory_order_relaxed);
+			for(;;) {
+				cell = &mCells[pos & mMask];
+				auto seq = cell->seq.load(std::memory_order_acquire);
+				auto diff = static_cast<std::intptr_t>(seq) -
+					static_cast<std::intptr_t>(pos);
+				if(diff == 0) {
+					if(mTail.compare_exchange_weak(
+						pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if(diff < 0) {
+					return false;
+				}
+				else {
+					pos = mTail.load(std::memory_order_relaxed);
+				}
+			}
+			cell->task = std::move(task);
+			cell->since.store(since, std::memory_order_relaxed);
+			cell->seq.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+	inline auto PriorityPool::TaskQueue::tryPop(
+		TTask& task, std::int64_t& since
+		) -> bool
+		{
+			Cell* cell;
+			auto pos = mHead.load(std::memory_order_relaxed);
+			for(;;) {
+				cell = &mCells[pos & mMask];
+				auto seq = cell->seq.load(std::memory_order_acquire);
+				auto diff = static_cast<std::intptr_t>(seq) -
+					static_cast<std::intptr_t>(pos + 1);
+				if(diff == 0) {
+					if(mHead.compare_exchange_weak(
+						pos, pos + 1, std::memory_order_relaxed))
+					{
+						break;
+					}
+				}
+				else if(diff < 0) {
+					return false;
+				}
+				else {
+					pos = mHead.load(std::memory_order_relaxed);
+				}
+			}
+			task = std::move(cell->task);
+			cell->task = nullptr;
+			since = cell->since.load(std::memory_order_relaxed);
+			cell->seq.store(pos + mMask + 1, std::memory_order_release);
+			return true;
+		}
+	inline auto PriorityPool::TaskQueue::headSince() const noexcept
+		-> std::optional<std::int64_t>
+		{
+			auto pos = mHead.load(std::memory_order_relaxed);
+			auto& cell = mCells[pos & mMask];
+			if(cell.seq.load(std::memory_order_acquire) != pos + 1) {
+				return std::nullopt;
+			}
+			return cell.since.load(std::memory_order_relaxed);
+		}
+
+	//---- Histogram -----------------------------------------------------------
+
+	inline auto PriorityPool::Histogram::Bucket(std::uint64_t ns) noexcept
+		-> std::size_t
+		{
+			if(ns < 8) {
+				return static_cast<std::size_t>(ns);
+			}
+			std::size_t msb = 63;
+			while(!(ns >> msb)) {
+				--msb;
+			}
+			auto sub = (ns >> (msb - 3)) & 7;
+			return (msb - 2) * 8 + static_cast<std::size_t>(sub);
+		}
+	inline auto PriorityPool::Histogram::Upper(std::size_t bucket) noexcept
+		-> std::uint64_t
+		{
+			if(bucket < 8) {
+				return bucket;
+			}
+			auto msb = bucket / 8 + 2;
+			auto lower = (8 + std::uint64_t{bucket % 8}) << (msb - 3);
+			return lower + (std::uint64_t{1} << (msb - 3)) - 1;
+		}
+	inline void PriorityPool::Histogram::add(std::uint64_t ns) noexcept {
+			auto& count = counts[Bucket(ns)];
+			count.store(
+				count.load(std::memory_order_relaxed) + 1,
+				std::memory_order_relaxed
+				);
+			if(ns > max.load(std::memory_order_relaxed)) {
+				max.store(ns, std::memory_order_relaxed);
+			}
+		}
+
+	//---- PriorityPool --------------------------------------------------------
+
+	inline PriorityPool::PriorityPool(
+		std::size_t threads, std::size_t capacity,
+		std::chrono::nanoseconds aging
+		):
+		mAging{aging.count()}
+		{
+			if(threads == 0) {
+				threads = std::thread::hardware_concurrency();
+			}
+			if(threads == 0) {
+				threads = 1;
+			}
+			for(std::size_t i = 0; i < kNumPriorities; ++i) {
+				mQueues.push_back(std::make_unique<TaskQueue>(capacity));
+			}
+			for(std::size_t i = 0; i < threads; ++i) {
+				mWorkers.push_back(std::make_unique<Worker>());
+			}
+			for(auto& w: mWorkers) {
+				auto p = w.get();
+				p->thread = std::thread{[this, p] { work(*p); }};
+			}
+		}
+	inline PriorityPool::~PriorityPool() {
+			{
+				std::lock_guard<std::mutex> lock{mMutex};
+				mStop = true;
+			}
+			mWake.notify_all();
+			for(auto& w: mWorkers) {
+				w->thread.join();
+			}
+		}
+	inline auto PriorityPool::Now() noexcept -> std::int64_t {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()
+				).count();
+		}
+	inline void PriorityPool::submit(TTask task) {
+			submit(OptArg<Priority>::GetDefault(), std::move(task));
+		}
+	inline void PriorityPool::submit(kPriority priority, TTask task) {
+			while(!trySubmit(priority, task)) {
+				if(tlPool == this) {
+					Run(*tlWorker, static_cast<std::size_t>(priority),
+						task, Now());
+					return;
+				}
+				std::this_thread::yield();
+			}
+		}
+	inline auto PriorityPool::trySubmit(TTask& task) -> bool {
+			return trySubmit(OptArg<Priority>::GetDefault(), task);
+		}
+	inline auto PriorityPool::trySubmit(kPriority priority, TTask& task)
+		-> bool
+		{
+			// Counting the task first means a worker that sees a nonzero
+			// count may find the queue still empty, but never the reverse.
+			mPending.fetch_add(1);
+			auto& queue = *mQueues[static_cast<std::size_t>(priority)];
+			if(!queue.tryPush(task, Now())) {
+				mPending.fetch_sub(1);
+				return false;
+			}
+			if(mSleepers.load() > 0) {
+				{ std::lock_guard<std::mutex> lock{mMutex}; }
+				mWake.notify_one();
+			}
+			return true;
+		}
+	inline auto PriorityPool::pick(
+		TTask& task, std::int64_t& since, std::size_t& level
+		) -> bool
+		{
+			for(;;) {
+				auto now = Now();
+				bool any = false;
+				std::int64_t best = 0;
+				for(auto i = kNumPriorities; i-- > 0;) {
+					auto head = mQueues[i]->headSince();
+					if(!head) {
+						continue;
+					}
+					auto score = static_cast<std::int64_t>(i);
+					if(mAging > 0) {
+						score = score * mAging + (now - *head);
+					}
+					if(!any || score > best) {
+						any = true;
+						best = score;
+						level = i;
+					}
+				}
+				if(!any) {
+					return false;
+				}
+				if(mQueues[level]->tryPop(task, since)) {
+					return true;
+				}
+			}
+		}
+	inline void PriorityPool::Run(
+		Worker& self, std::size_t level, TTask& task, std::int64_t since
+		) noexcept
+		{
+			auto wait = Now() - since;
+			self.waits[level].add(
+				wait > 0 ? static_cast<std::uint64_t>(wait) : 0
+				);
+			WithDefArg<Priority> priority{static_cast<kPriority>(level)};
+			task();
+			task = nullptr;
+		}
+	inline void PriorityPool::work(Worker& self) {
+			tlPool = this;
+			tlWorker = &self;
+			TTask task;
+			std::int64_t since;
+			std::size_t level;
+			for(;;) {
+				if(pick(task, since, level)) {
+					mPending.fetch_sub(1);
+					Run(self, level, task, since);
+					continue;
+				}
+				std::unique_lock<std::mutex> lock{mMutex};
+				mSleepers.fetch_add(1);
+				mWake.wait(lock, [this] {
+					return mPending.load() > 0 || mStop;
+				});
+				mSleepers.fetch_sub(1);
+				if(mStop && mPending.load() == 0) {
+					return;
+				}
+			}
+		}
+	inline auto PriorityPool::latency(kPriority priority) const
+		-> LatencyStats
+		{
+			auto level = static_cast<std::size_t>(priority);
+			std::array<std::uint64_t, Histogram::kBuckets> counts{};
+			LatencyStats stats;
+			std::uint64_t max = 0;
+			for(auto& w: mWorkers) {
+				auto& h = w->waits[level];
+				for(std::size_t i = 0; i < Histogram::kBuckets; ++i) {
+					auto n = h.counts[i].load(std::memory_order_relaxed);
+					counts[i] += n;
+					stats.count += n;
+				}
+				max = std::max(max, h.max.load(std::memory_order_relaxed));
+			}
+			auto at = [&](double q) {
+				auto rank = static_cast<std::uint64_t>(q * stats.count);
+				std::uint64_t seen = 0;
+				for(std::size_t i = 0; i < Histogram::kBuckets; ++i) {
+					seen += counts[i];
+					if(seen > rank) {
+						return std::chrono::nanoseconds{static_cast<
+							std::chrono::nanoseconds::rep
+							>(std::min(Histogram::Upper(i), max))};
+					}
+				}
+				return std::chrono::nanoseconds{};
+			};
+			if(stats.count > 0) {
+				stats.p50 = at(0.5);
+				stats.p90 = at(0.9);
+				stats.p99 = at(0.99);
+				stats.p999 = at(0.999);
+				stats.max = std::chrono::nanoseconds{
+					static_cast<std::chrono::nanoseconds::rep>(max)
+					};
+			}
+			return stats;
+		}
+}
+
+#endif
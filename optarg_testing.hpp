@@ -0,0 +1,249 @@
+#ifndef OPTARG_TESTING_HPP
+#define OPTARG_TESTING_HPP
+
+/**
+optarg_testing
+
+This companion to optarg.hpp lets tests that change defaults run side by side
+on the threads of one process, rather than each in a process of its own. Since
+defaults are per thread, tests on different threads cannot see each other's
+changes anyway. What remains is to keep a test from seeing what an earlier
+test on the same thread left behind, which is what DefaultsSandbox does:
+
+	TEST_F(ParserTest, Strict) {
+		oarg::DefaultsSandbox sandbox; // starts from a clean slate
+		oarg::OptArg<strict_b>::SetDefault(true);
+		...
+		EXPECT_TRUE(sandbox.leaks().empty()); // fails: strict_b leaked
+	}
+
+Or let TestPool run your tests for you, each in a sandbox of its own:
+
+	oarg::TestPool pool;
+	pool.add("strict", [] { ... });
+	pool.add("lenient", [] { ... });
+	for(auto& t: pool.run()) {
+		if(!t.passed()) { ... }
+	}
+
+Either way, a few things are beyond the sandbox's reach:
+
+	- It only knows about tags registered with OPTARG_REGISTER (see the tag
+	  registry in optarg.hpp), so register every tag your tests touch.
+	- Leaks are found by comparing a tag's default with its initial value,
+	  which needs an operator== for the value type (unless the tag is a
+	  process_root tag). Tags without one still get reset, just not checked.
+	- Root defaults, ThreadGroup overrides and ResetGroup affect the whole
+	  process. Tests that use them should go through TestPool::addSerial.
+**/
+
+#include "optarg.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace oarg {
+
+	/**
+	DefaultsSandbox
+
+	On construction, this reverts (see OptArg's RevertDefault) the calling
+	thread's default for each registered tag the thread has overridden, and
+	takes the thread out of any ThreadGroup, so that the thread sees defaults
+	the way a new thread would. On destruction, it does this again, so that
+	whatever runs next on the thread gets a clean slate too.
+
+	Methods:
+		leaks:
+			Returns: the names of the registered tags whose defaults the
+				calling thread has overridden since the sandbox started, plus
+				"ThreadGroup" if the thread has joined one
+
+			Any WithDefArg declared within the sandbox should be out of scope
+			by the time you call this, or its tag will show up.
+	**/
+	class DefaultsSandbox {
+	public:
+		DefaultsSandbox() { Clear(); }
+		DefaultsSandbox(const DefaultsSandbox&) = delete;
+		~DefaultsSandbox() { Clear(); }
+
+		auto leaks() const -> std::vector<std::string>;
+
+	private:
+		static void Clear();
+	};
+
+	/**
+	TestOutcome
+
+	What became of one test run by TestPool. failure holds the what() of any
+	exception the test threw, and leaks what DefaultsSandbox::leaks reported
+	after it finished.
+	**/
+	struct TestOutcome {
+		std::string name;
+		std::string failure;
+		std::vector<std::string> leaks;
+
+		auto passed() const noexcept -> bool {
+			return failure.empty() && leaks.empty();
+		 }
+	};
+
+	/**
+	TestPool
+
+	Runs tests on a fixed set of threads, each test in a DefaultsSandbox of
+	its own. A test fails if it throws or leaks a default. (Tests that report
+	failure by aborting the process can still be run this way, but one
+	failure will of course take down the rest.)
+
+	The threads are started anew for each run(), and the thread calling run()
+	never runs tests itself, so its own defaults are left alone.
+
+	Constructor:
+		threads: how many threads run() should use (0 for one per core)
+
+	Methods:
+		add:
+			Queues a test that may run in parallel with others.
+		addSerial:
+			Queues a test that must have the process to itself. These run
+			one at a time after all the parallel tests are done.
+		run:
+			Runs all the tests queued so far and clears the queue.
+			Returns: the outcomes, in the order the tests were added
+	**/
+	class TestPool {
+	public:
+		explicit TestPool(std::size_t threads = 0) noexcept;
+
+		void add(std::string name, std::function<void()> test);
+		void addSerial(std::string name, std::function<void()> test);
+		auto run() -> std::vector<TestOutcome>;
+
+	private:
+		struct Test {
+			std::string name;
+			std::function<void()> fn;
+			bool serial;
+		};
+
+		static auto RunOne(const Test& test) -> TestOutcome;
+
+		std::size_t mThreads;
+		std::vector<Test> mTests;
+	};
+
+	//==== Implementation ======================================================
+
+	//---- DefaultsSandbox -----------------------------------------------------
+
+	inline void DefaultsSandbox::Clear() {
+			for(auto tag: RegisteredTags()) {
+				if(tag->overridden() != false) {
+					tag->revert();
+				}
+			}
+			ThreadGroup::Leave();
+		}
+	inline auto DefaultsSandbox::leaks() const -> std::vector<std::string> {
+			std::vector<std::string> names;
+			for(auto tag: RegisteredTags()) {
+				if(tag->overridden().value_or(false)) {
+					names.emplace_back(tag->name);
+				}
+			}
+			if(detail::GroupMembership::tlIndex != 0) {
+				names.emplace_back("ThreadGroup");
+			}
+			return names;
+		}
+
+	//---- TestPool ------------------------------------------------------------
+
+	inline TestPool::TestPool(std::size_t threads) noexcept:
+		mThreads{threads ? threads : std::thread::hardware_concurrency()}
+		{
+			if(mThreads == 0) {
+				mThreads = 1;
+			}
+		}
+	inline void TestPool::add(std::string name, std::function<void()> test) {
+			mTests.push_back(Test{std::move(name), std::move(test), false});
+		}
+	inline void TestPool::addSerial(
+		std::string name, std::function<void()> test
+		)
+		{
+			mTests.push_back(Test{std::move(name), std::move(test), true});
+		}
+	inline auto TestPool::RunOne(const Test& test) -> TestOutcome {
+			TestOutcome outcome{test.name, {}, {}};
+			DefaultsSandbox sandbox;
+			try {
+				test.fn();
+			}
+			catch(const std::exception& e) {
+				outcome.failure = e.what();
+				if(outcome.failure.empty()) {
+					outcome.failure = "exception";
+				}
+			}
+			catch(...) {
+				outcome.failure = "unknown exception";
+			}
+			outcome.leaks = sandbox.leaks();
+			return outcome;
+		}
+	inline auto TestPool::run() -> std::vector<TestOutcome> {
+			auto tests = std::move(mTests);
+			mTests.clear();
+			std::vector<TestOutcome> outcomes(tests.size());
+
+			std::vector<std::size_t> parallel;
+			for(std::size_t i = 0; i < tests.size(); ++i) {
+				if(!tests[i].serial) {
+					parallel.push_back(i);
+				}
+			}
+			std::atomic<std::size_t> next{0};
+			auto work = [&] {
+				for(;;) {
+					auto k = next.fetch_add(1, std::memory_order_relaxed);
+					if(k >= parallel.size()) {
+						break;
+					}
+					outcomes[parallel[k]] = RunOne(tests[parallel[k]]);
+				}
+			};
+			std::vector<std::thread> threads;
+			auto n = std::min(mThreads, parallel.size());
+			for(std::size_t i = 0; i < n; ++i) {
+				threads.emplace_back(work);
+			}
+			for(auto& t: threads) {
+				t.join();
+			}
+
+			// Not on the calling thread, whose defaults a sandbox would clear.
+			std::thread{[&] {
+				for(std::size_t i = 0; i < tests.size(); ++i) {
+					if(tests[i].serial) {
+						outcomes[i] = RunOne(tests[i]);
+					}
+				}
+			}}.join();
+			return outcomes;
+		}
+}
+
+#endif
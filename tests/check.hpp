@@ -0,0 +1,92 @@
+#ifndef OPTARG_TESTS_CHECK_HPP
+#define OPTARG_TESTS_CHECK_HPP
+
+/**
+check.hpp
+
+The little the tests need in the way of a framework. CHECK aborts the test with
+the failing condition if it does not hold. Bench times a loop and prints the
+result as one line, tagged with the build's sanitizer configuration:
+
+	[thread] stress/nested: 4.1 Mops/s
+**/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef OPTARG_TEST_CONFIG
+	#define OPTARG_TEST_CONFIG ""
+#endif
+
+#define CHECK(...) \
+	do { \
+		if(!(__VA_ARGS__)) { \
+			std::fprintf( \
+				stderr, "%s:%d: CHECK failed: %s\n", \
+				__FILE__, __LINE__, #__VA_ARGS__ \
+				); \
+			std::abort(); \
+		} \
+	} while(false)
+
+namespace oarg::test {
+
+	inline auto Config() noexcept -> const char* {
+		return *OPTARG_TEST_CONFIG ? OPTARG_TEST_CONFIG : "plain";
+	}
+
+	/*
+	Scale lets you run longer (or shorter) stress loops than the default by
+	setting the OPTARG_TEST_SCALE environment variable to a multiplier.
+	*/
+	inline auto Scale(std::size_t n) -> std::size_t {
+		static const double scale = [] {
+			auto s = std::getenv("OPTARG_TEST_SCALE");
+			auto x = s ? std::atof(s) : 1.0;
+			return x > 0 ? x : 1.0;
+		}();
+		auto scaled = static_cast<std::size_t>(static_cast<double>(n) * scale);
+		return scaled ? scaled : 1;
+	}
+
+	using TClock = std::chrono::steady_clock;
+
+	inline auto Seconds(TClock::time_point start) noexcept -> double {
+		return std::chrono::duration<double>(TClock::now() - start).count();
+	}
+
+	// Prints ops operations over secs seconds as a rate.
+	inline void ReportRate(const char* what, double ops, double secs) {
+		std::printf(
+			"[%s] %s: %.2f Mops/s\n", Config(), what, ops / secs / 1e6
+			);
+	}
+
+	// Prints a per-operation time in nanoseconds.
+	inline void ReportNs(const char* what, double ns) {
+		std::printf("[%s] %s: %.1f ns\n", Config(), what, ns);
+	}
+
+	/*
+	Bench runs fn n times and returns the average time per call in
+	nanoseconds. Keep fn's result observable (e.g. through Sink) so that
+	the compiler cannot drop the work.
+	*/
+	template<typename Fn>
+		auto Bench(std::size_t n, Fn&& fn) -> double {
+			auto start = TClock::now();
+			for(std::size_t i = 0; i < n; ++i) {
+				fn(i);
+			}
+			return Seconds(start) * 1e9 / static_cast<double>(n);
+		}
+
+	template<typename T>
+		void Sink(const T& value) noexcept {
+			asm volatile("" : : "g"(&value) : "memory");
+		}
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*
+Real-time tags must never allocate once a thread has warmed them up. This test
+replaces the global operator new and delete with versions that count the
+allocations made on the calling thread while it is "armed", then runs every
+kind of operation on real-time tags with the count armed and checks that it
+stays at zero.
+
+A std::string tag is run the same way first, to show that the harness does
+catch allocations when they happen.
+*/
+
+#include "optarg.hpp"
+#include "check.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace {
+
+	thread_local bool tlArmed = false;
+	thread_local std::size_t tlAllocs = 0;
+
+	auto Allocate(std::size_t size, std::size_t align) noexcept -> void* {
+		if(tlArmed) {
+			++tlAllocs;
+		}
+		if(size == 0) {
+			size = 1;
+		}
+		if(align <= alignof(std::max_align_t)) {
+			return std::malloc(size);
+		}
+		return std::aligned_alloc(align, (size + align - 1) / align * align);
+	}
+	auto AllocateOrThrow(std::size_t size, std::size_t align) -> void* {
+		if(auto p = Allocate(size, align)) {
+			return p;
+		}
+		throw std::bad_alloc{};
+	}
+
+	// Counts the allocations fn makes on the calling thread.
+	template<typename Fn>
+		auto CountAllocs(Fn&& fn) -> std::size_t {
+			tlAllocs = 0;
+			tlArmed = true;
+			fn();
+			tlArmed = false;
+			return tlAllocs;
+		}
+}
+
+auto operator new(std::size_t n) -> void* {
+	return AllocateOrThrow(n, 0);
+}
+auto operator new[](std::size_t n) -> void* {
+	return AllocateOrThrow(n, 0);
+}
+auto operator new(std::size_t n, std::align_val_t a) -> void* {
+	return AllocateOrThrow(n, static_cast<std::size_t>(a));
+}
+auto operator new[](std::size_t n, std::align_val_t a) -> void* {
+	return AllocateOrThrow(n, static_cast<std::size_t>(a));
+}
+auto operator new(std::size_t n, const std::nothrow_t&) noexcept -> void* {
+	return Allocate(n, 0);
+}
+auto operator new[](std::size_t n, const std::nothrow_t&) noexcept -> void* {
+	return Allocate(n, 0);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+	std::free(p);
+}
+
+using namespace oarg;
+
+namespace {
+
+	struct rt_grp {};
+
+	struct Pan { float left, right; };
+
+	struct gain_f {
+		using type = float;
+		static constexpr bool realtime = true;
+	};
+	struct pan_p { using type = Pan; static constexpr bool realtime = true; };
+	struct mute_u {
+		using type = unsigned;
+		static constexpr bool realtime = true;
+	};
+	struct depth_i {
+		using type = int;
+		static constexpr bool realtime = true;
+		static constexpr std::size_t stack_depth = 4;
+		static constexpr auto overflow = kOverflow::Skip;
+	};
+	struct arena_d {
+		using type = double;
+		static constexpr bool realtime = true;
+		static constexpr auto storage = kStorage::Arena;
+	};
+	struct grouped_i {
+		using type = int;
+		static constexpr bool realtime = true;
+		static constexpr auto storage = kStorage::Arena;
+		using group = rt_grp;
+	};
+	struct root_i {
+		using type = int;
+		static constexpr bool realtime = true;
+		static constexpr bool process_root = true;
+	};
+	struct name_s { using type = std::string; };
+
+	void Nest(int depth) {
+		WithDefArg<gain_f> gain{0.5f * static_cast<float>(depth)};
+		WithDefArg<pan_p> pan{Pan{1.0f, 0.0f}};
+		WithDefFlags<mute_u> mute{1u << depth, kBitwise::XOr};
+		WithDefArg<depth_i> deep{depth};
+		WithDefArg<arena_d> arena{
+			1.0, [](double& a, const double& b) noexcept { a += b; }
+			};
+		WithDefArg<grouped_i> grouped{depth};
+		WithDefArg<root_i> root{depth};
+		CHECK(OptArg<gain_f>{}.value() == 0.5f * static_cast<float>(depth));
+		CHECK(OptArg<pan_p>{}.value().left == 1.0f);
+		CHECK(OptArg<grouped_i>{}.value() == depth);
+		CHECK(OptArg<root_i>{}.value() == depth);
+		test::Sink(OptArg<mute_u>{}.value());
+		test::Sink(OptArg<arena_d>{}.value());
+		if(depth < 8) {
+			// Goes past depth_i's stack_depth, which it must skip quietly.
+			Nest(depth + 1);
+		}
+	}
+
+	void RealTimeThread() {
+		WarmDefaults<
+			gain_f, pan_p, mute_u, depth_i, arena_d, grouped_i, root_i
+			>();
+		auto n = CountAllocs([] {
+			for(std::size_t k = 0, n = test::Scale(1000); k < n; ++k) {
+				Nest(0);
+				OptArg<gain_f>::SetDefault(1.0f);
+				OptArg<gain_f>::SetDefault(0.0f);
+				CHECK(OptArg<gain_f>{0.25f}.value() == 0.25f);
+			}
+		});
+		CHECK(n == 0);
+	}
+}
+
+int main() {
+	// The harness must see a string default's allocation.
+	auto n = CountAllocs([] {
+		WithDefArg<name_s> name{std::string(100, 'x')};
+		test::Sink(OptArg<name_s>{}.value());
+	});
+	CHECK(n > 0);
+
+	OptArg<root_i>::SetRootDefault(42);
+	std::thread{RealTimeThread}.join();
+	RealTimeThread();
+	std::puts("ok");
+}
@@ -0,0 +1,27 @@
+/*
+Each REJECT_* case must fail to compile with the real-time static_assert. The
+test harness builds this file once per case and checks for that message.
+*/
+
+#include "optarg.hpp"
+
+#include <string>
+
+using namespace oarg;
+
+namespace {
+	struct rt_s {
+		using type = std::string;
+		static constexpr bool realtime = true;
+	};
+	struct rt_i { using type = int; static constexpr bool realtime = true; };
+}
+
+int main() {
+#if defined(REJECT_VALUE_TYPE)
+	return static_cast<int>(OptArg<rt_s>{}.value().size());
+#elif defined(REJECT_MERGE_FN)
+	WithDefArg<rt_i> def{1, [](int& a, const int& b) { a += b; }};
+	return OptArg<rt_i>{}.value();
+#endif
+}
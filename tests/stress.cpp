@@ -0,0 +1,338 @@
+/*
+Multithreaded stress test: random nested WithDefArg and WithDefFlags scopes
+on many threads at once, over every storage kind a default can have. Each
+thread keeps its own record of what every default should be and checks it at
+every step, so any leak between threads or any scope that fails to restore
+shows up as a CHECK failure (or, under TSan, as a race report).
+
+The scenarios:
+	nested: deep random scopes on long-lived threads
+	throw: the same, but unwinding out of the middle by exception
+	churn: short-lived threads, each of which must start from scratch
+	pool: a fixed pool running many small tasks, each of which must leave
+		its worker the way it found it
+	root: readers of a process_root tag while a writer republishes it
+*/
+
+#include "optarg.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace oarg;
+
+namespace {
+
+	struct stress_grp {};
+
+	struct n_i { using type = int; };
+	struct f_u { using type = unsigned; };
+	struct s_s { using type = std::string; };
+	struct a_s {
+		using type = std::string;
+		static constexpr auto storage = kStorage::Arena;
+	};
+	struct g_s {
+		using type = std::string;
+		static constexpr auto storage = kStorage::Arena;
+		using group = stress_grp;
+	};
+	struct d_i {
+		using type = int;
+		static constexpr std::size_t stack_depth = 16;
+	};
+	struct r_i {
+		using type = int;
+		static constexpr bool process_root = true;
+	};
+
+	constexpr std::size_t kThreads = 8;
+	constexpr int kMaxDepth = 8;
+
+	struct Expect {
+		int n = 0;
+		unsigned f = 0;
+		std::string s, a, g;
+		int d = 0;
+	};
+
+	struct Boom: std::runtime_error {
+		Boom(): std::runtime_error{"boom"} {}
+	};
+
+	void Verify(const Expect& e) {
+		CHECK(OptArg<n_i>::GetDefault() == e.n);
+		CHECK(OptArg<f_u>::GetDefault() == e.f);
+		CHECK(OptArg<s_s>::GetDefault() == e.s);
+		CHECK(OptArg<a_s>::GetDefault() == e.a);
+		CHECK(OptArg<g_s>::GetDefault() == e.g);
+		CHECK(OptArg<d_i>::GetDefault() == e.d);
+	}
+
+	auto Text(std::mt19937& rng) -> std::string {
+		// Long enough to defeat the small-string buffer now and then.
+		return std::string(rng() % 40, static_cast<char>('a' + rng() % 26));
+	}
+
+	/*
+	Nest opens a random scope, checks the defaults inside it, recurses, and
+	checks again once the scope has closed. A depth of throwAt makes it
+	throw from the innermost level instead of returning.
+	*/
+	void Nest(
+		std::mt19937& rng, const Expect& outer, int depth, int throwAt,
+		std::size_t& ops
+		)
+	{
+		Verify(outer);
+		if(depth == throwAt) {
+			throw Boom{};
+		}
+		if(depth == kMaxDepth || rng() % 4 == 0) {
+			return;
+		}
+		auto e = outer;
+		++ops;
+		switch(rng() % 6) {
+		case 0: {
+			e.n = static_cast<int>(rng());
+			WithDefArg<n_i> scope{e.n};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		case 1: {
+			auto mask = 1u << (rng() % 32);
+			auto op = static_cast<kBitwise>(rng() % 3);
+			switch(op) {
+				case kBitwise::Or: e.f |= mask; break;
+				case kBitwise::AndC: e.f &= ~mask; break;
+				case kBitwise::XOr: e.f ^= mask; break;
+			}
+			WithDefFlags<f_u> scope{mask, op};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		case 2: {
+			e.s = Text(rng);
+			WithDefArg<s_s> scope{e.s};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		case 3: {
+			auto suffix = Text(rng);
+			e.a += suffix;
+			WithDefArg<a_s> scope{
+				suffix, [](std::string& a, const std::string& b) { a += b; }
+				};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		case 4: {
+			e.g = Text(rng);
+			WithDefArg<g_s> scope{e.g};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		default: {
+			e.d = static_cast<int>(rng() % 1000);
+			WithDefArg<d_i> scope{e.d};
+			Nest(rng, e, depth + 1, throwAt, ops);
+			break;
+		}
+		}
+		Verify(outer);
+	}
+
+	// Runs fn on kThreads threads at once and returns the total of the
+	// operation counts they report.
+	auto RunThreads(const std::function<std::size_t(std::size_t)>& fn)
+		-> std::size_t
+	{
+		std::atomic<std::size_t> total{0};
+		std::vector<std::thread> threads;
+		for(std::size_t i = 0; i < kThreads; ++i) {
+			threads.emplace_back([&fn, &total, i] {
+				total += fn(i);
+			});
+		}
+		for(auto& t: threads) {
+			t.join();
+		}
+		return total;
+	}
+
+	void Nested() {
+		auto start = test::TClock::now();
+		auto ops = RunThreads([](std::size_t i) {
+			std::mt19937 rng{static_cast<std::uint32_t>(i)};
+			std::size_t ops = 0;
+			for(std::size_t k = 0, n = test::Scale(30000); k < n; ++k) {
+				Nest(rng, Expect{}, 0, -1, ops);
+			}
+			Verify(Expect{});
+			return ops;
+		});
+		test::ReportRate("stress/nested", ops, test::Seconds(start));
+	}
+
+	void Throw() {
+		auto start = test::TClock::now();
+		auto ops = RunThreads([](std::size_t i) {
+			std::mt19937 rng{static_cast<std::uint32_t>(100 + i)};
+			std::size_t ops = 0;
+			for(std::size_t k = 0, n = test::Scale(10000); k < n; ++k) {
+				try {
+					Nest(
+						rng, Expect{}, 0,
+						static_cast<int>(rng() % (kMaxDepth + 1)), ops
+						);
+				}
+				catch(const Boom&) {
+				}
+				Verify(Expect{});
+			}
+			return ops;
+		});
+		test::ReportRate("stress/throw", ops, test::Seconds(start));
+	}
+
+	void Churn() {
+		// The parent's defaults must not leak into the threads it starts.
+		WithDefArg<n_i> n{-1};
+		WithDefArg<s_s> s{"parent"};
+		WithDefArg<g_s> g{"parent"};
+		auto start = test::TClock::now();
+		std::size_t threads = 0;
+		std::atomic<std::size_t> ops{0};
+		for(std::size_t k = 0, n = test::Scale(200); k < n; ++k) {
+			std::vector<std::thread> batch;
+			for(std::size_t i = 0; i < kThreads; ++i) {
+				batch.emplace_back([&ops, seed = k * kThreads + i] {
+					std::mt19937 rng{static_cast<std::uint32_t>(seed)};
+					std::size_t mine = 0;
+					Nest(rng, Expect{}, 0, -1, mine);
+					ops += mine;
+				});
+			}
+			for(auto& t: batch) {
+				t.join();
+			}
+			threads += batch.size();
+		}
+		auto secs = test::Seconds(start);
+		test::ReportNs(
+			"stress/churn per thread", secs * 1e9 / static_cast<double>(threads)
+			);
+		CHECK(OptArg<n_i>{}.value() == -1);
+		CHECK(OptArg<s_s>{}.value() == "parent");
+		CHECK(OptArg<g_s>{}.value() == "parent");
+	}
+
+	void Pool() {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::deque<std::uint32_t> tasks;
+		bool done = false;
+		std::atomic<std::size_t> ops{0};
+
+		auto work = [&] {
+			std::size_t mine = 0;
+			for(;;) {
+				std::uint32_t seed;
+				{
+					std::unique_lock<std::mutex> lock{mutex};
+					cv.wait(lock, [&] { return done || !tasks.empty(); });
+					if(tasks.empty()) {
+						break;
+					}
+					seed = tasks.front();
+					tasks.pop_front();
+				}
+				std::mt19937 rng{seed};
+				try {
+					Nest(rng, Expect{}, 0, static_cast<int>(seed % 16), mine);
+				}
+				catch(const Boom&) {
+				}
+				Verify(Expect{});
+			}
+			ops += mine;
+		};
+
+		auto start = test::TClock::now();
+		std::vector<std::thread> workers;
+		for(std::size_t i = 0; i < kThreads; ++i) {
+			workers.emplace_back(work);
+		}
+		auto n = test::Scale(20000);
+		for(std::uint32_t k = 0; k < n; ++k) {
+			std::lock_guard<std::mutex> lock{mutex};
+			tasks.push_back(k);
+			cv.notify_one();
+		}
+		{
+			std::lock_guard<std::mutex> lock{mutex};
+			done = true;
+		}
+		cv.notify_all();
+		for(auto& t: workers) {
+			t.join();
+		}
+		test::ReportRate("stress/pool tasks", n, test::Seconds(start));
+	}
+
+	void Root() {
+		// Readers that never override r_i must only ever see values the
+		// writer published (all even), never a torn or stale-freed one. The
+		// writer keeps publishing for as long as any reader is still going.
+		constexpr std::size_t kReaders = kThreads - 1;
+		std::atomic<std::size_t> running{kReaders};
+		auto n = test::Scale(2000000);
+		std::vector<std::thread> readers;
+		auto start = test::TClock::now();
+		for(std::size_t i = 0; i < kReaders; ++i) {
+			readers.emplace_back([&running, n, i] {
+				for(std::size_t k = 0; k < n; ++k) {
+					auto v = OptArg<r_i>{}.value();
+					CHECK(v % 2 == 0);
+					if(i % 2 == 0) {
+						WithDefArg<r_i> own{1};
+						CHECK(OptArg<r_i>{}.value() == 1);
+					}
+				}
+				--running;
+			});
+		}
+		int published = 0;
+		while(running > 0) {
+			OptArg<r_i>::SetRootDefault(2 * ++published);
+			std::this_thread::yield();
+		}
+		for(auto& t: readers) {
+			t.join();
+		}
+		test::ReportRate(
+			"stress/root reads", kReaders * n, test::Seconds(start)
+			);
+		CHECK(OptArg<r_i>{}.value() == 2 * published);
+	}
+}
+
+int main() {
+	Nested();
+	Throw();
+	Churn();
+	Pool();
+	Root();
+	std::puts("ok");
+}
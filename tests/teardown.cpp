@@ -0,0 +1,82 @@
+/*
+Thread create+exit with 500 non-trivial defaults, stored as plain thread_locals
+(one exit handler per tag) or in the per-thread arena (one exit handler for
+all of them). Besides timing both, the test checks that every default a thread
+built gets destroyed exactly once when the thread exits.
+*/
+
+#include "optarg.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace oarg;
+
+namespace {
+
+	constexpr std::size_t kTags = 500;
+
+	std::atomic<std::size_t> gDestroyed{0};
+
+	// A string that reports its destruction, if it was ever given a value.
+	struct Counted {
+		std::string text;
+
+		Counted() = default;
+		Counted(const Counted&) = default;
+		auto operator = (const Counted&) -> Counted& = default;
+		~Counted() {
+			if(!text.empty()) {
+				++gDestroyed;
+			}
+		}
+	};
+
+	template<std::size_t I>
+		struct tls_c { using type = Counted; };
+	template<std::size_t I>
+		struct arena_c {
+			using type = Counted;
+			static constexpr auto storage = kStorage::Arena;
+		};
+
+	// Gives every tag in the pack a default long enough to live on the heap.
+	template<template<std::size_t> class Tag, std::size_t... I>
+		void TouchAll(std::index_sequence<I...>) {
+			Counted c;
+			c.text.assign(64, 'x');
+			(OptArg<Tag<I>>::SetDefault(c), ...);
+		}
+
+	// Returns the average time in ns to start, run and join a thread.
+	template<typename Fn>
+		auto ThreadNs(std::size_t n, Fn fn) -> double {
+			return test::Bench(n, [&fn](std::size_t) {
+				std::thread{fn}.join();
+			});
+		}
+
+	template<template<std::size_t> class Tag>
+		void Run(const char* what, double emptyNs) {
+			auto n = test::Scale(200);
+			gDestroyed = 0;
+			auto ns = ThreadNs(n, [] {
+				TouchAll<Tag>(std::make_index_sequence<kTags>{});
+			});
+			// The local Counted in TouchAll accounts for the extra one.
+			CHECK(gDestroyed == n * (kTags + 1));
+			test::ReportNs(what, ns - emptyNs);
+		}
+}
+
+int main() {
+	auto emptyNs = ThreadNs(test::Scale(200), [] {});
+	test::ReportNs("teardown/empty thread", emptyNs);
+	Run<tls_c>("teardown/500 tls tags, extra per thread", emptyNs);
+	Run<arena_c>("teardown/500 arena tags, extra per thread", emptyNs);
+	std::puts("ok");
+}